@@ -1,7 +1,8 @@
 #include "app.hpp"
-#include "save-wav.hpp"
+#include "kernels.hpp"
 #include <SDL.h>
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <fstream>
 #include <functional>
@@ -17,6 +18,44 @@ extern "C" {
 }
 
 static const auto preferredGrainSize = 1500;
+static const auto hops = std::array{0, 256, 512, 1024, 2048, 4096};
+static const char *hopNames[] = {"off", "256", "512", "1024", "2048", "4096"};
+// in ResamplerQuality order
+static const char *resamplerNames[] = {"linear", "cubic Hermite", "windowed sinc"};
+// in WavFormat order
+static const char *exportFormatNames[] = {"16-bit PCM", "24-bit PCM", "32-bit float"};
+
+static const char *SpecVertexShader = R"(#version 130
+void main()
+{
+  gl_TexCoord[0] = gl_MultiTexCoord0;
+  gl_FrontColor = gl_Color;
+  gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;
+}
+)";
+
+// spectra are stored as log2 of the magnitude, k scales the magnitude before the colormap lookup;
+// s is the column inside the tile, t goes over the visible notes before the pitch bend shift
+static const char *SpecFragmentShader = R"(#version 130
+uniform sampler2D spec;
+uniform sampler1D colormap;
+uniform sampler1D pitchBends;
+uniform float logK;
+uniform float startNote;
+uniform float rangeNote;
+uniform bool isLog;
+uniform float nyquist;
+void main()
+{
+  float note = gl_TexCoord[0].t * rangeNote - texelFetch(pitchBends, int(gl_FragCoord.x), 0).r;
+  if (note < 0.0 || note >= rangeNote)
+    discard;
+  note += startNote;
+  float bin = isLog ? note / 128.0 : 55.0 * exp2((note - 24.0) / 12.0) / nyquist;
+  float v = exp2(texture2D(spec, vec2(gl_TexCoord[0].s, bin)).r + logK);
+  gl_FragColor = texture1D(colormap, clamp(v, 0.0, 255.0) / 256.0) * gl_Color;
+}
+)";
 
 auto App::draw() -> void
 {
@@ -60,9 +99,20 @@ auto App::draw() -> void
   if (exportWavDlg.draw())
     exportWav(exportWavDlg.getSelectedFile());
 
+  if (exporter)
+  {
+    ImGui::Begin("Export");
+    ImGui::ProgressBar(exporter->progress());
+    if (ImGui::Button("Cancel"))
+      exporter->cancel();
+    ImGui::End();
+    if (exporter->isDone())
+      exporter = nullptr;
+  }
+
   {
     ImGui::Begin("Control Center");
-    ImGui::Text("<%.2f %.2f %.2f>", startTime, cursorSec, startTime + rangeTime);
+    ImGui::Text("<%.2f %.2f %.2f>", startTime, cursorSec.load(), startTime + rangeTime);
     ImGui::SameLine();
     ImGui::Text("<%.2f %.2f>", startNote, startNote + rangeNote);
     ImGui::Checkbox("Follow", &followMode);
@@ -74,12 +124,48 @@ auto App::draw() -> void
     ImGui::SliderFloat("Brightness", &brightness, 0.0f, 100.0f);
     float newK = powf(2, brightness / 10 + 9);
     if (std::fabs(k - newK) > 0.001f)
-    {
       k = newK;
+    // STFT hop
+    if (ImGui::Combo("STFT hop", &hopIdx, hopNames, static_cast<int>(hops.size())))
       specCache = nullptr;
+    // log frequency spectrum
+    auto isLog = specScale == SpecScale::log;
+    if (ImGui::Checkbox("Log frequency", &isLog))
+    {
+      specScale = isLog ? SpecScale::log : SpecScale::linear;
+      if (spec)
+        resetSpec();
     }
     // Tempo
     ImGui::SliderFloat("Tempo", &tempo, 30.0f, 250.0f);
+    // spectrum cache
+    ImGui::SliderInt("Spectrum cache", &specCacheMb, 16, 4096, "%d MB");
+    if (ImGui::IsItemDeactivatedAfterEdit() && spec)
+      resetSpec();
+    // grain resampling, playback picks it up with the next grain
+    auto resamplerIdx = static_cast<int>(resamplerQuality.load());
+    if (ImGui::Combo("Resampler", &resamplerIdx, resamplerNames, static_cast<int>(std::size(resamplerNames))))
+      resamplerQuality = static_cast<ResamplerQuality>(resamplerIdx);
+    // export
+    ImGui::Combo("Export format", &exportFormatIdx, exportFormatNames, static_cast<int>(std::size(exportFormatNames)));
+    if (exportFormatIdx != static_cast<int>(WavFormat::float32))
+    {
+      ImGui::SameLine();
+      ImGui::Checkbox("Dither", &isExportDither);
+    }
+    ImGui::Text("Audio callback: %.0f us (max %.0f us) underruns: %llu",
+                callbackUs.load(std::memory_order_relaxed),
+                maxCallbackUs.load(std::memory_order_relaxed),
+                static_cast<unsigned long long>(underruns.load(std::memory_order_relaxed)));
+    if (spec)
+    {
+      const auto stats = spec->stats();
+      ImGui::Text("Cache: %.1f MB hits: %llu misses: %llu evictions: %llu",
+                  stats.bytesResident / 1024. / 1024.,
+                  static_cast<unsigned long long>(stats.hits),
+                  static_cast<unsigned long long>(stats.misses),
+                  static_cast<unsigned long long>(stats.evictions));
+    }
     const auto &io = ImGui::GetIO();
     ImGui::Text("FPS: %.1f (%.3f ms)", io.Framerate, 1000.0f / io.Framerate);
     ImGui::End();
@@ -107,9 +193,7 @@ auto App::draw() -> void
   }
   if (audio)
   {
-    audio->lock();
     displayCursor = cursorSec;
-    audio->unlock();
     if (displayCursor > startTime + rangeTime && isAudioPlaying)
       followMode = true;
     if (followMode)
@@ -119,10 +203,7 @@ auto App::draw() -> void
                               ? (startTime + (desieredStart - startTime) * 0.2)
                               : desieredStart;
       if (std::abs(newStart - startTime) < 0.001)
-      {
         startTime = newStart;
-        waveformCache.clear();
-      }
     }
   }
 }
@@ -137,8 +218,6 @@ auto App::openFile(const std::string &fileName) -> void
     loadMelonixFile(fileName);
 }
 
-static auto GrainSpectrSize = 2 * 4096;
-
 auto App::importFile(const std::string &fileName) -> void
 {
   LOG("import", fileName);
@@ -153,88 +232,16 @@ auto App::importFile(const std::string &fileName) -> void
 auto App::preproc() -> void
 {
   selectedMarker = std::end(markers);
-  {
-    // generate grains
-    grains.clear();
-    auto start = 0;
-    auto nextEstimation = GrainSpectrSize;
-    while (start < static_cast<int>(wavData.size() - preferredGrainSize - 1))
-    {
-      bool found = false;
-      for (auto i = 0; i < preferredGrainSize; ++i)
-      {
-        const auto idx = start + preferredGrainSize + (i % 2 == 0 ? i / 2 : -i / 2);
-        const auto isZeroCrossing = [&]() {
-          const auto lookAround = 7;
-          if (idx < lookAround)
-            return false;
-          if (idx >= static_cast<int>(wavData.size() - lookAround - 1))
-            return false;
-          for (int j = 0; j < lookAround; ++j)
-          {
-            if (wavData[idx - j] >= 0)
-              return false;
-            if (wavData[idx + 1 + j] < 0)
-              return false;
-          }
-          return true;
-        }();
-        if (isZeroCrossing)
-        {
-          grains.insert(
-            std::make_pair(start,
-                           std::make_tuple(std::span<float>(wavData.data() + start, idx - start),
-                                           idx - start - preferredGrainSize)));
-          LOG("good grain", start, idx - start);
-          start = idx;
-          found = true;
-          break;
-        }
-      }
-      if (!found)
-      {
-        LOG("bad grain", start, preferredGrainSize);
-        found = false;
-        for (auto i = start + preferredGrainSize + preferredGrainSize / 2;
-             i < static_cast<int>(wavData.size() - 1);
-             ++i)
-        {
-          const auto isZeroCrossing = [&]() {
-            const auto lookAround = 3;
-            if (i < lookAround)
-              return false;
-            if (i >= static_cast<int>(wavData.size() - lookAround - 1))
-              return false;
-            for (int j = 0; j < lookAround; ++j)
-            {
-              if (wavData[i - j] >= 0)
-                return false;
-              if (wavData[i + 1 + j] < 0)
-                return false;
-            }
-            return true;
-          }();
-          if (isZeroCrossing)
-          {
-            grains.insert(
-              std::make_pair(start,
-                             std::make_tuple(std::span<float>(wavData.data() + start, i - start),
-                                             i - start - preferredGrainSize)));
-            LOG("bad grain", start, i - start);
-            start = i;
-            found = true;
-            break;
-          }
-        }
-        if (!found)
-          break;
-      }
-      if (start > nextEstimation)
-        nextEstimation += GrainSpectrSize;
-    }
-  }
-
-  calcPicks();
+  // a newly loaded project can have as many markers as the previous one
+  ++markersVersion;
+  timeMap.update(TimeMap{markers, sampleRate, wavData.size()});
+  // the spectrum cache key; the audio only changes on load, so resetSpec() does not rehash it
+  wavHash = SpecPyramid::hashWav(wavData);
+  grains.build(wavData, preferredGrainSize);
+  LOG("grains", grains.size());
+
+  minMaxIndex = MinMaxIndex{wavData};
+  waveformCache.clear();
   auto want = [&]() {
     SDL_AudioSpec ret;
     ret.freq = sampleRate;
@@ -247,182 +254,219 @@ auto App::preproc() -> void
   audio = std::make_unique<sdl::Audio>(nullptr, false, &want, &have, 0, [&](Uint8 *stream, int len) {
     playback(reinterpret_cast<float *>(stream), len / sizeof(float));
   });
+  startSynth();
 
-  spec = std::make_unique<Spec>(std::span<float>{wavData.data(), wavData.data() + wavData.size()});
+  resetSpec();
 }
 
-auto App::playback(float *w, size_t dur) -> void
+auto App::resetSpec() -> void
 {
-  if (cursorSec < 0 || cursorSec >= duration())
-    isAudioPlaying = false;
+  specCache = nullptr;
+  spec = nullptr;
+  // the spectrum pyramid lives next to the project file, imported audio gets one on the first save
+  auto pyramid =
+    saveName.empty() ? nullptr : std::make_unique<SpecPyramid>(saveName + ".spec", wavData, wavHash, specScale);
+  if (pyramid && !pyramid->isOpen())
+    pyramid = nullptr;
+  spec = std::make_unique<Spec>(std::span<float>{wavData.data(), wavData.data() + wavData.size()},
+                                sampleRate,
+                                specScale,
+                                std::move(pyramid),
+                                static_cast<size_t>(specCacheMb) << 20,
+                                [this]() {
+                                  // wake the main loop up to show the new column
+                                  if (isSpecEventPending.exchange(true))
+                                    return;
+                                  auto event = SDL_Event{};
+                                  event.type = SDL_USEREVENT;
+                                  SDL_PushEvent(&event);
+                                });
+}
 
-  if (!isAudioPlaying)
+auto App::isAnimating() const -> bool
+{
+  return isAudioPlaying || exporter != nullptr;
+}
+
+auto App::playback(float *w, size_t dur) -> void
+{
+  // runs on the audio thread: no locks, no allocations, only copies from the ring
+  const auto t0 = std::chrono::steady_clock::now();
+  const auto out = std::span<float>{w, dur};
+  auto n = size_t{0};
+  if (isAudioPlaying)
   {
-    audio->pause(true);
-    for (; dur > 0; --dur, ++w)
-      *w = 0;
-    for (int i = 0; i < 100; ++i)
+    const auto gen = seekGen.load();
+    if (gen != playbackGen && synthGen.load(std::memory_order_acquire) == gen)
     {
-      *w *= .01f * i;
-      --w;
+      // the synth restarted from the new cursor, the samples before that are stale
+      playbackRing.skipTo(synthValidFrom.load());
+      playbackGen = gen;
     }
-    restWav.clear();
-
-    return;
-  }
-
-  auto tmpCursor = cursorSec + 1. * restWav.size() / sampleRate;
-  while (restWav.size() < dur + preferredGrainSize)
-    tmpCursor += process(tmpCursor, restWav);
-
-  if (!restWav.empty())
-  {
-    auto sz = std::min(restWav.size(), dur);
-
-    for (auto i = 0U; i < sz; ++i)
+    if (gen == playbackGen)
     {
-      *w = restWav[i];
-      ++w;
+      n = playbackRing.read(out);
+      cursorSec.fetch_add(1. * n / sampleRate);
+      if (n < dur)
+      {
+        if (isSynthDone)
+          isAudioPlaying = false;
+        else
+          underruns.fetch_add(1, std::memory_order_relaxed);
+      }
     }
+  }
+  std::fill(std::begin(out) + n, std::end(out), 0.f);
 
-    dur -= sz;
-    restWav.erase(restWav.begin(), restWav.begin() + sz);
-    cursorSec += 1. * sz / sampleRate;
+  if (!isAudioPlaying)
+  {
+    audio->pause(true);
+    // fade out the tail
+    for (auto i = size_t{0}; i < std::min<size_t>(n, 100); ++i)
+      out[n - 1 - i] *= .01f * i;
   }
+
+  const auto us = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - t0).count();
+  callbackUs.store(us, std::memory_order_relaxed);
+  if (us > maxCallbackUs.load(std::memory_order_relaxed))
+    maxCallbackUs.store(us, std::memory_order_relaxed);
 }
 
-auto App::process(double cursor, std::vector<float> &wav) -> double
+auto App::synth() -> void
 {
-  const auto pitchBend = time2PitchBend(cursor);
-  const auto rate = powf(2, pitchBend / 12);
-  auto it1 = [&]() {
-    const auto sample = time2Sample(cursor);
-    return grains.lower_bound(sample);
-  }();
-
-  if (it1 == std::end(grains))
+  // renders grains ahead of the audio callback; restarts from cursorSec every time the UI seeks
+  auto gen = uint64_t{0};
+  auto cursor = 0.;
+  auto isDone = false;
+  auto grainCursor = GrainIndex::Cursor{grains};
+  // the part of grainWav already in the ring; a grain can be longer than the free space
+  auto grainPos = size_t{0};
+  // the callback plays a seek once it is published, after its first grain is in the ring, so the
+  // silence before that does not count as an underrun
+  auto validFrom = uint64_t{0};
+  auto isPublished = true;
+  const auto publish = [&]() {
+    if (isPublished)
+      return;
+    isPublished = true;
+    synthValidFrom = validFrom;
+    synthGen.store(gen, std::memory_order_release);
+  };
+  // the UI changes isAudioPlaying, seekGen and isSynthRunning under synthMutex before notifying, so
+  // checking them under the lock cannot miss a wakeup
+  const auto isWoken = [&]() { return !isAudioPlaying || seekGen != gen || !isSynthRunning; };
+  std::unique_lock<std::mutex> lock(synthMutex);
+  while (isSynthRunning)
   {
-    isAudioPlaying = false;
-    for (auto i = 0; i < preferredGrainSize; ++i)
-      wav.push_back(0.f);
-    return 0;
-  }
-
-  const auto grain = std::get<0>(it1->second);
-  const auto nextGrainFirstSample = [&]() {
-    auto sz = 0;
-    for (auto i = 0;; ++i)
+    if (!isAudioPlaying)
     {
-      auto idxF = double{};
-      std::modf(i * rate + bias, &idxF);
-      const auto idx = static_cast<size_t>(idxF);
-      if (idx >= grain.size())
-        break;
-      ++sz;
+      synthCv.wait(lock, [&]() { return isAudioPlaying || !isSynthRunning; });
+      continue;
     }
-    const auto sample = time2Sample(cursor + 1. * sz / sampleRate);
-    auto it2 = grains.lower_bound(sample);
-    if (it2 == std::end(grains))
-      return 0.f;
-
-    return std::get<0>(it2->second).front();
-  }();
-  prevGrain = grain;
-
-  auto sz = 0;
-  for (auto i = 0;; ++i)
-  {
-    auto idxF = float{};
-    const auto curBias = std::modf(i * rate + bias, &idxF);
-    const auto idx = static_cast<size_t>(idxF);
-    if (idx >= grain.size())
-      break;
-    wav.push_back((1.f - curBias) * grain[idx] +
-                  curBias * (idx + 1 < grain.size() ? grain[idx + 1] : nextGrainFirstSample));
-    ++sz;
+    const auto g = seekGen.load();
+    if (g != gen)
+    {
+      gen = g;
+      cursor = cursorSec.load();
+      isDone = false;
+      isSynthDone = false;
+      validFrom = playbackRing.writePos();
+      isPublished = false;
+      grainWav.clear();
+      grainPos = 0;
+    }
+    if (grainPos < grainWav.size())
+    {
+      grainPos += playbackRing.write(std::span<const float>{grainWav}.subspan(grainPos));
+      if (grainPos < grainWav.size())
+      {
+        publish();
+        synthCv.wait_for(lock, std::chrono::milliseconds{2}, isWoken);
+        continue;
+      }
+      grainWav.clear();
+      grainPos = 0;
+      publish();
+    }
+    if (isDone || playbackRing.size() >= PlaybackAhead)
+    {
+      publish();
+      synthCv.wait_for(lock, std::chrono::milliseconds{2}, isWoken);
+      continue;
+    }
+    // rendering without the lock keeps seek() and togglePlay() from waiting for a grain
+    lock.unlock();
+    const auto map = timeMap.read();
+    const auto dt = cursor >= 0 && cursor < map->duration() ? process(*map, grainCursor, resamplerQuality, cursor, &grainWav) : 0.;
+    lock.lock();
+    if (dt <= 0.)
+    {
+      isDone = true;
+      isSynthDone = true;
+      continue;
+    }
+    // written on the next iterations, as the callback frees space
+    cursor += dt;
   }
-  return 1. * sz / sampleRate;
 }
 
-auto App::calcPicks() -> void
+auto App::startSynth() -> void
 {
-  picks.clear();
-  auto lvl = 0U;
+  isSynthRunning = true;
+  synthThread = std::thread(&App::synth, this);
+}
 
-  if (wavData.size() <= (1 << (lvl + 1)))
+auto App::stopSynth() -> void
+{
+  if (!synthThread.joinable())
     return;
-  while (picks.size() <= lvl)
-    picks.push_back({});
-  for (auto i = 0U; i < wavData.size() / (1 << (lvl + 1)); ++i)
   {
-    const auto min = std::min(wavData[i * 2], wavData[i * 2 + 1]);
-    const auto max = std::max(wavData[i * 2], wavData[i * 2 + 1]);
-    picks[lvl].push_back(std::make_pair(min, max));
+    std::lock_guard<std::mutex> lock(synthMutex);
+    isSynthRunning = false;
   }
+  synthCv.notify_one();
+  synthThread.join();
+}
 
-  for (;;)
+auto App::seek(double sec) -> void
+{
+  cursorSec = sec;
   {
-    ++lvl;
-    if (wavData.size() <= (1 << (lvl + 1)))
-      break;
-    while (picks.size() <= lvl)
-      picks.push_back({});
-    for (auto i = 0U; i < wavData.size() / (1 << (lvl + 1)); ++i)
-    {
-      const auto min = std::min(picks[lvl - 1][i * 2].first, picks[lvl - 1][i * 2 + 1].first);
-      const auto max = std::max(picks[lvl - 1][i * 2].second, picks[lvl - 1][i * 2 + 1].second);
-      picks[lvl].push_back(std::make_pair(min, max));
-    }
+    std::lock_guard<std::mutex> lock(synthMutex);
+    ++seekGen;
   }
-  waveformCache.clear();
+  synthCv.notify_one();
 }
 
-auto App::getMinMaxFromRange(int start, int end) -> std::pair<float, float>
+auto App::process(const TimeMap &map,
+                  GrainIndex::Cursor &grainCursor,
+                  ResamplerQuality quality,
+                  double cursor,
+                  std::vector<float> *wav) const -> double
 {
-  if (start >= end)
-  {
-    if (start >= 0 && start < static_cast<int>(wavData.size()))
-      return {wavData[start], wavData[start]};
-    return {0.f, 0.f};
-  }
+  const auto pitchBend = map.time2PitchBend(cursor);
+  const auto rate = powf(2, pitchBend / 12);
+  const auto g = grainCursor.lowerBound(map.time2Sample(cursor));
+  if (g == grains.size())
+    return 0;
 
-  if (start < 0 || end < 0)
-    return {0.f, 0.f};
-
-  if (start >= static_cast<int>(wavData.size()) || end >= static_cast<int>(wavData.size()))
-    return {0.f, 0.f};
-
-  if (end - start == 1)
-    return {wavData[start], wavData[start]};
-
-  // calculate level
-  const auto lvl = static_cast<size_t>(std::log2(end - start));
-  // Get the minimum and maximum from the level
-  const auto lvlStart = start / (1 << lvl);
-  auto minMax = [&]() {
-    if (lvl - 1 >= picks.size())
-      return std::pair{0.f, 0.f};
-    if (lvlStart >= static_cast<int>(picks[lvl - 1].size()))
-      return std::pair{0.f, 0.f};
-    return picks[lvl - 1][lvlStart];
+  const auto samples = std::span{wavData};
+  const auto start = static_cast<size_t>(grains.start(g));
+  const auto grain = samples.subspan(start, grains.grainSize(g));
+  const auto sz = Resampler::outputSize(grain.size(), rate, bias);
+  if (!wav)
+    return 1. * sz / sampleRate;
+  const auto before = samples.first(start).last(std::min<size_t>(start, Resampler::Context));
+  const auto after = [&]() {
+    const auto next = grainCursor.lowerBound(map.time2Sample(cursor + 1. * sz / sampleRate));
+    if (next == grains.size())
+      return std::span<const float>{};
+    const auto nextStart = static_cast<size_t>(grains.start(next));
+    return samples.subspan(nextStart, std::min<size_t>(samples.size() - nextStart, Resampler::Context));
   }();
-  // Get left range
-  const auto leftEnd = lvlStart * (1 << lvl);
-  if (leftEnd >= start)
-  {
-    const auto leftMinMax = getMinMaxFromRange(start, leftEnd);
-    minMax.first = std::min(minMax.first, leftMinMax.first);
-    minMax.second = std::max(minMax.second, leftMinMax.second);
-  }
-  // Get right range
-  const auto rightStart = (lvlStart + 1) * (1 << lvl);
-  if (rightStart < end)
-  {
-    const auto rightMinMax = getMinMaxFromRange(rightStart, end);
-    minMax.first = std::min(minMax.first, rightMinMax.first);
-    minMax.second = std::max(minMax.second, rightMinMax.second);
-  }
-  return minMax;
+
+  resampler.process(quality, before, grain, after, rate, bias, *wav);
+  return 1. * sz / sampleRate;
 }
 
 auto App::glDraw() -> void
@@ -448,32 +492,34 @@ auto App::glDraw() -> void
     clearColor.x * clearColor.w, clearColor.y * clearColor.w, clearColor.z * clearColor.w, clearColor.w);
   glClear(GL_COLOR_BUFFER_BIT);
 
-  if (waveformCache.size() != static_cast<size_t>(Width))
+  // waveform columns are keyed by their absolute pixel index at the current zoom, panning shifts the
+  // cache and computes only the newly exposed columns
+  const auto firstColumn = startTime * Width / rangeTime;
+  const auto firstWaveformColumn = static_cast<int>(std::floor(firstColumn));
+  const auto columnsNum = static_cast<int>(std::ceil(Width)) + 1;
+  if (waveformCache.size() != static_cast<size_t>(columnsNum) || waveformRangeTime != rangeTime)
+  {
     waveformCache.clear();
-
-  if (waveformCache.empty())
+    waveformRangeTime = rangeTime;
+  }
+  if (updateWaveform(firstWaveformColumn, columnsNum, Width))
   {
-    for (auto x = 0; x < Width; ++x)
+    vertices.clear();
+    for (auto x = 0U; x < waveformCache.size(); ++x)
     {
-      audio->lock();
-      const auto left = time2Sample(1. * x / Width * rangeTime + startTime);
-      const auto right = time2Sample(1. * (x + 1) / Width * rangeTime + startTime);
-      auto minMax = getMinMaxFromRange(left, right);
-      waveformCache.push_back(minMax);
-      audio->unlock();
+      const auto minMax = waveformCache[x];
+      vertices.push_back(Vertex{1.f * x, minMax.first, 0.f, 0.f, 1.f, 0.f, 1.f, 1.f});
+      vertices.push_back(Vertex{x + 1.f, minMax.second, 0.f, 0.f, 1.f, 0.f, 1.f, 1.f});
     }
+    waveformVbo.upload(vertices);
   }
 
   // draw waveform
-  glColor3f(1.f, 0.f, 1.f);
-  glBegin(GL_LINE_STRIP);
-  for (auto x = 0; x < Width; ++x)
-  {
-    const auto minMax = waveformCache[x];
-    glVertex2f(x, minMax.first);
-    glVertex2f(x + 1, minMax.second);
-  }
-  glEnd();
+  glMatrixMode(GL_MODELVIEW);
+  glPushMatrix();
+  glTranslatef(static_cast<float>(firstWaveformColumn - firstColumn), 0.f, 0.f);
+  waveformVbo.draw(GL_LINE_STRIP);
+  glPopMatrix();
 
   // draw spectogram
   glViewport(
@@ -484,94 +530,155 @@ auto App::glDraw() -> void
   glEnable(GL_TEXTURE_1D);
   glColor3f(1.f, 1.f, 1.f);
 
-  auto step = powf(2.f, 1.f / 12.f);
-
-  for (auto x = 0; x < Width; ++x)
+  if (!specShader)
   {
-    auto texture = getTex(startTime + x * rangeTime / Width);
-    glBindTexture(GL_TEXTURE_1D, texture);
-
-    glBegin(GL_QUADS);
+    specShader = std::make_unique<Shader>(SpecVertexShader, SpecFragmentShader);
+    glBindTexture(GL_TEXTURE_1D, colormapTexture);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexImage1D(GL_TEXTURE_1D,        // target
+                 0,                    // level
+                 GL_RGBA,              // internalFormat
+                 256,                  // width
+                 0,                    // border
+                 GL_RGBA,              // format
+                 GL_UNSIGNED_BYTE,     // type
+                 colormapLut().data()  // data
+    );
+  }
 
-    audio->lock();
-    const auto pitchBend = time2PitchBend(startTime + x * rangeTime / Width);
-    audio->unlock();
-    const auto startFreq = 55. * pow(2., (startNote - 24) / 12.);
-    auto freq = static_cast<float>(startFreq / sampleRate * 2.);
-    for (auto i = 0; i < rangeNote; ++i)
+  if (spec)
+  {
+    // columns finished from now on are picked up by the next frame
+    isSpecEventPending = false;
+    if (!specCache)
+      specCache = std::make_unique<SpecCache>(
+        *spec, Width, rangeTime, hops[hopIdx], [this](double val) { return timeMap->time2Sample(val); });
+    // fill the spectrogram around the playback cursor first, around the screen center otherwise
+    const auto isCursorVisible = displayCursor >= startTime && displayCursor < startTime + rangeTime;
+    specCache->setFocus(isAudioPlaying && isCursorVisible ? displayCursor : startTime + rangeTime / 2);
+
+    // the shader shifts every screen column by its pitch bend
+    pitchBends.resize(static_cast<size_t>(Width));
+    for (auto x = 0U; x < pitchBends.size(); ++x)
+      pitchBends[x] = timeMap->time2PitchBend(startTime + x * rangeTime / Width);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_1D, pitchBendTexture);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexImage1D(GL_TEXTURE_1D,                           // target
+                 0,                                       // level
+                 GL_R32F,                                 // internalFormat
+                 static_cast<GLsizei>(pitchBends.size()), // width
+                 0,                                       // border
+                 GL_RED,                                  // format
+                 GL_FLOAT,                                // type
+                 pitchBends.data()                        // data
+    );
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_1D, colormapTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    specShader->use();
+    glUniform1i(specShader->uniform("spec"), 0);
+    glUniform1i(specShader->uniform("colormap"), 1);
+    glUniform1i(specShader->uniform("pitchBends"), 2);
+    glUniform1f(specShader->uniform("logK"), std::log2(k));
+    glUniform1f(specShader->uniform("startNote"), static_cast<float>(startNote));
+    glUniform1f(specShader->uniform("rangeNote"), rangeNote);
+    // log columns cover notes 0-128 linearly, linear ones cover 0 to Nyquist
+    glUniform1i(specShader->uniform("isLog"), spec->getScale() == SpecScale::log);
+    glUniform1f(specShader->uniform("nyquist"), sampleRate / 2.f);
+
+    // one quad per tile, tiles are aligned to absolute pixel columns at the current zoom
+    const auto firstTile = static_cast<int>(std::floor(firstColumn / SpecCache::TileWidth));
+    const auto lastTile = static_cast<int>(std::floor((firstColumn + Width) / SpecCache::TileWidth));
+    if (tileVbo.empty())
     {
-      glTexCoord1f(freq);
-      glVertex2f(x, (i + pitchBend) / rangeNote);
-
-      glTexCoord1f(freq * step);
-      glVertex2f(x, 1.f * (i + pitchBend + 1.f) / rangeNote);
-
-      glTexCoord1f(freq * step);
-      glVertex2f(x + 1.f, (i + pitchBend + 1.f) / rangeNote);
-
-      glTexCoord1f(freq);
-      glVertex2f(x + 1.f, (i + pitchBend) / rangeNote);
-
-      freq *= step;
+      const auto w = static_cast<float>(SpecCache::TileWidth);
+      const auto quad = std::array{Vertex{0.f, 0.f, 0.f, 0.f, 1.f, 1.f, 1.f, 1.f},
+                                   Vertex{0.f, 1.f, 0.f, 1.f, 1.f, 1.f, 1.f, 1.f},
+                                   Vertex{w, 1.f, 1.f, 1.f, 1.f, 1.f, 1.f, 1.f},
+                                   Vertex{w, 0.f, 1.f, 0.f, 1.f, 1.f, 1.f, 1.f}};
+      tileVbo.upload(quad);
+    }
+    glMatrixMode(GL_MODELVIEW);
+    for (auto tile = firstTile; tile <= lastTile; ++tile)
+    {
+      glBindTexture(GL_TEXTURE_2D, specCache->getTile(tile));
+      glPushMatrix();
+      glTranslatef(static_cast<float>(tile * SpecCache::TileWidth - firstColumn), 0.f, 0.f);
+      tileVbo.draw(GL_QUADS);
+      glPopMatrix();
     }
-    glEnd();
+    glUseProgram(0);
   }
+
   // draw piano
   glColor4f(1.f, 1.f, 1.f, .096f);
   glBindTexture(GL_TEXTURE_1D, pianoTexture);
-  glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  std::vector<std::array<unsigned char, 3>> pianoData;
-  pianoData.resize(static_cast<int>(.9f * Height - 20));
-  auto lastNote = 0;
-  for (auto i = 0U; i < pianoData.size(); ++i)
+  // the keys only move on vertical pan and zoom or a window resize
+  const auto newPianoKey = std::make_tuple(static_cast<int>(.9f * Height - 20), startNote, rangeNote);
+  if (pianoKey != newPianoKey)
   {
-    const auto tmp = i * rangeNote + pianoData.size() / 2;
-    const auto note = static_cast<int>(tmp / pianoData.size() + startNote);
-    auto isBlack = std::array{
-      false, true, false, false, true, false, true, false, false, true, false, true}[note % 12];
-    unsigned char c = (note == lastNote) ? (isBlack ? 128 : 255) : 0;
-    pianoData[i] = std::array{c, c, c};
-    lastNote = note;
+    pianoKey = newPianoKey;
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    std::vector<std::array<unsigned char, 3>> pianoData;
+    pianoData.resize(std::get<0>(pianoKey));
+    auto lastNote = 0;
+    for (auto i = 0U; i < pianoData.size(); ++i)
+    {
+      const auto tmp = i * rangeNote + pianoData.size() / 2;
+      const auto note = static_cast<int>(tmp / pianoData.size() + startNote);
+      auto isBlack = std::array{
+        false, true, false, false, true, false, true, false, false, true, false, true}[note % 12];
+      unsigned char c = (note == lastNote) ? (isBlack ? 128 : 255) : 0;
+      pianoData[i] = std::array{c, c, c};
+      lastNote = note;
+    }
+    glTexImage1D(GL_TEXTURE_1D,                          // target
+                 0,                                      // level
+                 3,                                      // internalFormat
+                 static_cast<GLsizei>(pianoData.size()), // width
+                 0,                                      // border
+                 GL_RGB,                                 // format
+                 GL_UNSIGNED_BYTE,                       // type
+                 pianoData.data()                        // data
+    );
   }
-  glTexImage1D(GL_TEXTURE_1D,                          // target
-               0,                                      // level
-               3,                                      // internalFormat
-               static_cast<GLsizei>(pianoData.size()), // width
-               0,                                      // border
-               GL_RGB,                                 // format
-               GL_UNSIGNED_BYTE,                       // type
-               pianoData.data()                        // data
-  );
-
-  glBegin(GL_QUADS);
-  glTexCoord1f(0);
-  glVertex2f(0, 0);
-  glTexCoord1f(0);
-  glVertex2f(Width, 0);
-  glTexCoord1f(1);
-  glVertex2f(Width, 1);
-  glTexCoord1f(1);
-  glVertex2f(0, 1);
-  glEnd();
+
+  if (pianoWidth != Width)
+  {
+    pianoWidth = Width;
+    const auto quad = std::array{Vertex{0.f, 0.f, 0.f, 0.f, 1.f, 1.f, 1.f, .096f},
+                                 Vertex{Width, 0.f, 0.f, 0.f, 1.f, 1.f, 1.f, .096f},
+                                 Vertex{Width, 1.f, 1.f, 0.f, 1.f, 1.f, 1.f, .096f},
+                                 Vertex{0.f, 1.f, 1.f, 0.f, 1.f, 1.f, 1.f, .096f}};
+    pianoVbo.upload(quad);
+  }
+  pianoVbo.draw(GL_QUADS);
 
   glDisable(GL_TEXTURE_1D);
 
   // draw bars
-  const auto beatDuration = 60. / tempo;
-  glBegin(GL_LINES);
-  for (auto x = static_cast<int>(startTime / beatDuration); x * beatDuration < startTime + rangeTime;
-       ++x)
+  const auto newBarsKey = std::make_tuple(startTime, rangeTime, tempo, Width);
+  if (barsKey != newBarsKey)
   {
-    if (x % 4 == 0)
-      glColor4f(1.f, 1.f, 1.f, .096f);
-    else
-      glColor4f(1.f, 1.f, 1.f, .04f);
-    const auto pxX = static_cast<float>((x * beatDuration - startTime) * Width / rangeTime);
-    glVertex2f(pxX, 0);
-    glVertex2f(pxX, 1);
+    barsKey = newBarsKey;
+    const auto beatDuration = 60. / tempo;
+    vertices.clear();
+    for (auto x = static_cast<int>(startTime / beatDuration); x * beatDuration < startTime + rangeTime;
+         ++x)
+    {
+      const auto a = x % 4 == 0 ? .096f : .04f;
+      const auto pxX = static_cast<float>((x * beatDuration - startTime) * Width / rangeTime);
+      vertices.push_back(Vertex{pxX, 0.f, 0.f, 0.f, 1.f, 1.f, 1.f, a});
+      vertices.push_back(Vertex{pxX, 1.f, 0.f, 0.f, 1.f, 1.f, 1.f, a});
+    }
+    barsVbo.upload(vertices);
   }
-  glEnd();
+  barsVbo.draw(GL_LINES);
 
   drawMarkers();
 
@@ -581,44 +688,106 @@ auto App::glDraw() -> void
   glLoadIdentity();
   glOrtho(0, Width, 0.f, 1.f, -1, 1);
 
-  glColor4f(1.f, 0.f, 0.5f, 0.25f);
-  glBegin(GL_LINES);
-  glVertex2f(static_cast<float>((1.f * displayCursor - startTime) / rangeTime * Width), 0.f);
-  glVertex2f(static_cast<float>((1.f * displayCursor - startTime) / rangeTime * Width), 1.0f);
-  glEnd();
+  if (scrubberVbo.empty())
+  {
+    const auto line = std::array{Vertex{0.f, 0.f, 0.f, 0.f, 1.f, 0.f, .5f, .25f},
+                                 Vertex{0.f, 1.f, 0.f, 0.f, 1.f, 0.f, .5f, .25f}};
+    scrubberVbo.upload(line);
+  }
+  // the cursor moves every frame, move the line with the modelview matrix instead of reuploading it
+  glMatrixMode(GL_MODELVIEW);
+  glPushMatrix();
+  glTranslatef(static_cast<float>((1.f * displayCursor - startTime) / rangeTime * Width), 0.f, 0.f);
+  scrubberVbo.draw(GL_LINES);
+  glPopMatrix();
+}
+
+auto App::updateWaveform(int first, int columnsNum, float width) -> bool
+{
+  if (waveformCache.empty())
+  {
+    waveformCache.resize(columnsNum);
+    waveformFirst = first;
+    fillWaveform(0, columnsNum, width);
+    return true;
+  }
+
+  const auto shift = first - waveformFirst;
+  if (shift == 0)
+    return false;
+  waveformFirst = first;
+  if (std::abs(shift) >= columnsNum)
+  {
+    waveformCache.clear();
+    return updateWaveform(first, columnsNum, width);
+  }
+
+  if (shift > 0)
+  {
+    std::rotate(std::begin(waveformCache), std::begin(waveformCache) + shift, std::end(waveformCache));
+    fillWaveform(columnsNum - shift, columnsNum, width);
+  }
+  else
+  {
+    std::rotate(std::begin(waveformCache), std::end(waveformCache) + shift, std::end(waveformCache));
+    fillWaveform(0, -shift, width);
+  }
+  return true;
+}
+
+auto App::fillWaveform(int begin, int end, float width) -> void
+{
+  // column boundaries are increasing, so they are mapped to samples in one pass over the markers
+  waveformTimes.resize(end - begin + 1);
+  waveformSamples.resize(waveformTimes.size());
+  for (auto i = 0U; i < waveformTimes.size(); ++i)
+    waveformTimes[i] = 1. * (waveformFirst + begin + static_cast<int>(i)) / width * rangeTime;
+  timeMap->time2Samples(waveformTimes, waveformSamples);
+  for (auto x = begin; x < end; ++x)
+    waveformCache[x] = minMaxIndex.query(waveformSamples[x - begin], waveformSamples[x - begin + 1]);
 }
 
 auto App::drawMarkers() -> void
 {
   const auto &io = ImGui::GetIO();
   const auto Width = io.DisplaySize.x;
-  glBegin(GL_LINES);
-  for (const auto &marker : markers)
+  const auto newMarkersKey = std::make_tuple(startTime,
+                                             rangeTime,
+                                             startNote,
+                                             rangeNote,
+                                             Width,
+                                             markersVersion,
+                                             std::distance(std::begin(markers), selectedMarker));
+  if (markersKey != newMarkersKey)
   {
-    const auto x0 =
-      static_cast<float>((sample2Time(marker.sample) - startTime - marker.dTime) * Width / rangeTime);
-    const auto y0 = static_cast<float>((marker.note - startNote) / rangeNote);
-    const auto x = static_cast<float>((sample2Time(marker.sample) - startTime) * Width / rangeTime);
-    const auto y = static_cast<float>((marker.note - startNote + marker.pitchBend) / rangeNote);
-    glColor3f(0.5f, 0.5f, 0.5f);
-    glVertex2f(x0, y0);
-    glVertex2f(x, y);
-
-    glVertex2f(x0 - 2, y0 - 0.0025f);
-    glVertex2f(x0 + 2, y0 + 0.0025f);
-    glVertex2f(x0 + 2, y0 - 0.0025f);
-    glVertex2f(x0 - 2, y0 + 0.0025f);
-
-    if (selectedMarker != std::end(markers) && &marker == &(*selectedMarker))
-      glColor3f(0.f, 1.0f, 1.f);
-    else
-      glColor3f(0.f, 0.5f, 1.f);
-    glVertex2f(x - 2, y - 0.0025f);
-    glVertex2f(x + 2, y + 0.0025f);
-    glVertex2f(x + 2, y - 0.0025f);
-    glVertex2f(x - 2, y + 0.0025f);
+    markersKey = newMarkersKey;
+    vertices.clear();
+    const auto line = [this](float x0, float y0, float x1, float y1, std::array<float, 3> c) {
+      vertices.push_back(Vertex{x0, y0, 0.f, 0.f, c[0], c[1], c[2], 1.f});
+      vertices.push_back(Vertex{x1, y1, 0.f, 0.f, c[0], c[1], c[2], 1.f});
+    };
+    for (const auto &marker : markers)
+    {
+      const auto markerTime = timeMap->sample2Time(marker.sample);
+      const auto x0 = static_cast<float>((markerTime - startTime - marker.dTime) * Width / rangeTime);
+      const auto y0 = static_cast<float>((marker.note - startNote) / rangeNote);
+      const auto x = static_cast<float>((markerTime - startTime) * Width / rangeTime);
+      const auto y = static_cast<float>((marker.note - startNote + marker.pitchBend) / rangeNote);
+      const auto gray = std::array{0.5f, 0.5f, 0.5f};
+      line(x0, y0, x, y, gray);
+
+      line(x0 - 2, y0 - 0.0025f, x0 + 2, y0 + 0.0025f, gray);
+      line(x0 + 2, y0 - 0.0025f, x0 - 2, y0 + 0.0025f, gray);
+
+      const auto color = (selectedMarker != std::end(markers) && &marker == &(*selectedMarker))
+                           ? std::array{0.f, 1.0f, 1.f}
+                           : std::array{0.f, 0.5f, 1.f};
+      line(x - 2, y - 0.0025f, x + 2, y + 0.0025f, color);
+      line(x + 2, y - 0.0025f, x - 2, y + 0.0025f, color);
+    }
+    markersVbo.upload(vertices);
   }
-  glEnd();
+  markersVbo.draw(GL_LINES);
 }
 
 auto App::loadAudioFile(const std::string &path) -> void
@@ -812,7 +981,6 @@ auto App::mouseMotion(int x, int y, int dx, int dy, uint32_t state) -> void
       if (newStartTime + rangeTime > rightLimit)
         newStartTime = rightLimit - rangeTime;
       startTime = newStartTime;
-      waveformCache.clear();
       followMode = false;
     }
   }
@@ -822,9 +990,7 @@ auto App::mouseMotion(int x, int y, int dx, int dy, uint32_t state) -> void
     {
       if (!audio)
         return;
-      audio->lock();
-      cursorSec = std::clamp(x * rangeTime / Width + startTime, 0., duration());
-      audio->unlock();
+      seek(std::clamp(x * rangeTime / Width + startTime, 0., duration()));
     }
     else if (selectedMarker != std::end(markers))
     {
@@ -839,49 +1005,12 @@ auto App::mouseMotion(int x, int y, int dx, int dy, uint32_t state) -> void
 
 auto App::invalidateCache() const -> void
 {
-  if (audio)
-    audio->lock();
-  sample2TimeCache.clear();
-  time2SampleCache.clear();
-  time2PitchBendCache.clear();
+  ++markersVersion;
+  // the audio callback keeps playing from the previous snapshot until it picks this one up
+  timeMap.update(TimeMap{markers, sampleRate, wavData.size()});
   waveformCache.clear();
   if (specCache)
     specCache->clear();
-  if (audio)
-    audio->unlock();
-}
-
-auto App::getTex(double start) -> GLuint
-{
-  const auto &io = ImGui::GetIO();
-  const auto Width = io.DisplaySize.x;
-  if (!spec)
-  {
-    static Texture nullTexture = []() {
-      Texture ret;
-      static std::vector<std::array<unsigned char, 3>> data;
-      data.resize(16);
-
-      glBindTexture(GL_TEXTURE_1D, ret.get());
-      glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-      glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-      glTexImage1D(GL_TEXTURE_1D,                     // target
-                   0,                                 // level
-                   3,                                 // internalFormat
-                   static_cast<GLsizei>(data.size()), // width
-                   0,                                 // border
-                   GL_RGB,                            // format
-                   GL_UNSIGNED_BYTE,                  // type
-                   data.data()                        // data
-      );
-      return ret;
-    }();
-    return nullTexture.get();
-  }
-  if (!specCache)
-    specCache = std::make_unique<SpecCache>(
-      *spec, k, Width, rangeTime, [this](double val) { return time2Sample(val); });
-  return specCache->getTex(start);
 }
 
 auto App::mouseButton(int x, int y, uint32_t state, uint8_t button) -> void
@@ -893,10 +1022,8 @@ auto App::mouseButton(int x, int y, uint32_t state, uint8_t button) -> void
 
   if (!audio)
     return;
-  audio->lock();
   std::sort(
     markers.begin(), markers.end(), [](const auto &a, const auto &b) { return a.sample < b.sample; });
-  audio->unlock();
   if (button == SDL_BUTTON_LEFT)
   {
     if (state != SDL_PRESSED)
@@ -910,35 +1037,29 @@ auto App::mouseButton(int x, int y, uint32_t state, uint8_t button) -> void
       followMode = false;
       if (!audio)
         return;
-      audio->lock();
-      cursorSec = std::clamp(x * rangeTime / Width + startTime, 0., duration());
-      audio->unlock();
+      seek(std::clamp(x * rangeTime / Width + startTime, 0., duration()));
     }
     else
     {
       const auto time = x * rangeTime / Width + startTime;
-      audio->lock();
-      const auto sample = time2Sample(time);
-      audio->unlock();
+      const auto sample = timeMap->time2Sample(time);
       const auto note = (Height - y) * rangeNote / Height + startNote;
       const auto dTime = 8 * rangeTime / Width;
       const auto dNote = 8 * rangeNote / Height;
 
       auto it = std::find_if(
         std::begin(markers), std::end(markers), [dNote, dTime, note, this, time](const auto &m) {
-          return std::abs(sample2Time(m.sample) - time) < dTime &&
+          return std::abs(timeMap->sample2Time(m.sample) - time) < dTime &&
                  std::abs(m.note - note + m.pitchBend) < dNote;
         });
       if (it == std::end(markers))
       {
         // add marker
-        audio->lock();
-        const auto pitchBend = time2PitchBend(time);
+        const auto pitchBend = timeMap->time2PitchBend(time);
         markers.push_back(Marker{sample, note - pitchBend, 0., pitchBend});
         std::sort(markers.begin(), markers.end(), [](const auto &a, const auto &b) {
           return a.sample < b.sample;
         });
-        audio->unlock();
         invalidateCache();
         selectedMarker = std::find_if(std::begin(markers), std::end(markers), [sample](const auto &m) {
           return m.sample == sample;
@@ -965,15 +1086,13 @@ auto App::mouseButton(int x, int y, uint32_t state, uint8_t button) -> void
     const auto dNote = 8 * rangeNote / Height;
     auto it = std::find_if(
       std::begin(markers), std::end(markers), [dNote, dTime, note, this, time](const auto &m) {
-        return std::abs(sample2Time(m.sample) - time) < dTime &&
+        return std::abs(timeMap->sample2Time(m.sample) - time) < dTime &&
                std::abs(m.note - note + m.pitchBend) < dNote;
       });
     if (it != std::end(markers))
     {
-      audio->lock();
       markers.erase(it);
       selectedMarker = std::end(markers);
-      audio->unlock();
       invalidateCache();
     }
   }
@@ -983,9 +1102,16 @@ auto App::togglePlay() -> void
 {
   if (!audio)
     return;
-  isAudioPlaying = !isAudioPlaying;
+  {
+    std::lock_guard<std::mutex> lock(synthMutex);
+    isAudioPlaying = !isAudioPlaying.load();
+  }
   if (isAudioPlaying)
+  {
+    // the ring may hold samples rendered before the previous stop
+    seek(cursorSec);
     audio->pause(false);
+  }
 }
 
 auto App::cursorLeft() -> void
@@ -998,9 +1124,7 @@ auto App::cursorLeft() -> void
   const auto Width = io.DisplaySize.x;
   if (!audio)
     return;
-  audio->lock();
-  cursorSec = std::clamp(cursorSec - 4 * rangeTime / Width, 0., duration());
-  audio->unlock();
+  seek(std::clamp(cursorSec - 4 * rangeTime / Width, 0., duration()));
 }
 
 auto App::cursorRight() -> void
@@ -1012,113 +1136,12 @@ auto App::cursorRight() -> void
   const auto Width = io.DisplaySize.x;
   if (!audio)
     return;
-  audio->lock();
-  cursorSec = std::clamp(cursorSec + 4 * rangeTime / Width, 0., duration());
-  audio->unlock();
-}
-
-auto App::sample2Time(int val) const -> double
-{
-  // markers are sorted by sample
-
-  if (val <= 0)
-    return 1. * val / sampleRate;
-
-  const auto it = sample2TimeCache.find(val);
-  if (it != std::end(sample2TimeCache))
-    return it->second;
-
-  auto prevSample = 0;
-  auto prevTime = 0.0;
-  for (const auto &marker : markers)
-  {
-    const auto rightTime = prevTime + 1.0 * (marker.sample - prevSample) / sampleRate + marker.dTime;
-    if (val > prevSample && val <= marker.sample)
-    {
-      const auto ret =
-        prevTime + (val - prevSample) * (rightTime - prevTime) / (marker.sample - prevSample);
-      sample2TimeCache[val] = ret;
-      return ret;
-    }
-    prevSample = marker.sample;
-    prevTime = rightTime;
-  }
-
-  const auto ret = prevTime + 1. * (val - prevSample) / sampleRate;
-  sample2TimeCache[val] = ret;
-  return ret;
-}
-
-auto App::time2Sample(double val) const -> int
-{
-  // markers are sorted by sample
-
-  if (val <= 0)
-    return static_cast<int>(val * sampleRate);
-
-  const auto it = time2SampleCache.find(static_cast<int>(val * sampleRate));
-  if (it != std::end(time2SampleCache))
-    return it->second;
-
-  auto prevSample = 0;
-  auto prevTime = 0.0;
-  for (const auto &marker : markers)
-  {
-    const auto rightTime = prevTime + 1.0 * (marker.sample - prevSample) / sampleRate + marker.dTime;
-    if (val > prevTime && val <= rightTime)
-    {
-      const auto ret = static_cast<int>(prevSample + (val - prevTime) * (marker.sample - prevSample) /
-                                                       (rightTime - prevTime));
-      time2SampleCache[static_cast<int>(val * sampleRate)] = ret;
-      return ret;
-    }
-    prevSample = marker.sample;
-    prevTime = rightTime;
-  }
-
-  const auto ret = static_cast<int>(prevSample + (val - prevTime) * sampleRate);
-  time2SampleCache[static_cast<int>(val * sampleRate)] = ret;
-  return ret;
+  seek(std::clamp(cursorSec + 4 * rangeTime / Width, 0., duration()));
 }
 
 auto App::duration() const -> double
 {
-  return sample2Time(static_cast<int>(wavData.size() - 1));
-}
-
-auto App::time2PitchBend(double val) const -> float
-{
-  if (val <= 0)
-    return 0;
-  const auto it = time2PitchBendCache.find(static_cast<int>(val * sampleRate));
-  if (it != std::end(time2PitchBendCache))
-    return it->second;
-
-  auto prevSample = 0;
-  auto prevTime = 0.0;
-  auto prevPitchBend = 0.0;
-  for (const auto &marker : markers)
-  {
-    const auto rightTime = prevTime + 1.0 * (marker.sample - prevSample) / sampleRate + marker.dTime;
-    if (val > prevTime && val <= rightTime)
-    {
-      const auto ret = static_cast<float>(
-        prevPitchBend + (val - prevTime) * (marker.pitchBend - prevPitchBend) / (rightTime - prevTime));
-      time2PitchBendCache[static_cast<int>(val * sampleRate)] = ret;
-      return ret;
-    }
-    prevSample = marker.sample;
-    prevTime = rightTime;
-    prevPitchBend = marker.pitchBend;
-  }
-
-  if (val > duration())
-    return 0;
-
-  const auto ret =
-    static_cast<float>(prevPitchBend + (val - prevTime) * (0 - prevPitchBend) / (duration() - prevTime));
-  time2PitchBendCache[static_cast<int>(val * sampleRate)] = ret;
-  return ret;
+  return timeMap->duration();
 }
 
 auto App::loadMelonixFile(const std::string &fileName) -> void
@@ -1155,6 +1178,13 @@ auto App::loadMelonixFile(const std::string &fileName) -> void
 
 auto App::cleanup() -> void
 {
+  exporter = nullptr;
+  // the new session starts stopped, otherwise the UI keeps redrawing for a device that never plays
+  {
+    std::lock_guard<std::mutex> lock(synthMutex);
+    isAudioPlaying = false;
+  }
+  stopSynth();
   specCache = nullptr;
   spec = nullptr;
   audio = nullptr;
@@ -1187,29 +1217,32 @@ auto App::saveMelonixFile(std::string fileName) -> void
     return;
   }
   file.write(buf.data(), st.size());
+
+  if (spec && !spec->hasPyramid())
+    resetSpec();
 }
 
 App::App() : fileSaveAs("Save As..."), exportWavDlg("Export WAV") {}
 
-auto App::exportWav(const std::string &fileName) -> void
+App::~App()
 {
-  isAudioPlaying = false;
-  if (audio)
-    audio->pause(true);
-
-  auto pcm = std::vector<float>{};
-  for (auto tmpCursor = 0.;;)
-  {
-    const auto dt = process(tmpCursor, pcm);
-    if (dt <= 0.)
-      break;
-    tmpCursor += dt;
-  }
-
-  auto pcm16 = std::vector<int16_t>{};
-  pcm16.resize(pcm.size());
-  for (auto i = 0U; i < pcm.size(); ++i)
-    pcm16[i] = static_cast<int16_t>(pcm[i] * 32767.);
+  exporter = nullptr;
+  stopSynth();
+}
 
-  saveWav(fileName, pcm16, sampleRate);
+auto App::exportWav(const std::string &fileName) -> void
+{
+  exporter = nullptr;
+  exporter = std::make_unique<Exporter>(
+    fileName,
+    static_cast<WavFormat>(exportFormatIdx),
+    isExportDither,
+    markers,
+    *timeMap,
+    grains,
+    sampleRate,
+    [this, quality = resamplerQuality.load()](
+      const TimeMap &map, GrainIndex::Cursor &grainCursor, double cursor, std::vector<float> *wav) {
+      return process(map, grainCursor, quality, cursor, wav);
+    });
 }
@@ -1,15 +1,28 @@
 #pragma once
+#include "exporter.hpp"
 #include "file-open.hpp"
 #include "file-save-as.hpp"
+#include "grain-index.hpp"
 #include "marker.hpp"
+#include "min-max-index.hpp"
 #include "range.hpp"
+#include "rcu.hpp"
+#include "resampler.hpp"
+#include "shader.hpp"
 #include "spec-cache.hpp"
 #include "spec.hpp"
+#include "spsc-ring.hpp"
+#include "time-map.hpp"
+#include "vertex-buffer.hpp"
+#include <atomic>
+#include <condition_variable>
 #include <imgui/imgui.h>
 #include <list>
-#include <map>
+#include <mutex>
 #include <sdlpp/sdlpp.hpp>
 #include <ser/macro.hpp>
+#include <thread>
+#include <tuple>
 #include <unordered_map>
 
 #if defined(IMGUI_IMPL_OPENGL_ES2)
@@ -22,6 +35,7 @@ class App
 {
 public:
   App();
+  ~App();
   auto draw() -> void;
   auto glDraw() -> void;
   auto mouseMotion(int x, int y, int dx, int dy, uint32_t state) -> void;
@@ -30,6 +44,8 @@ public:
   auto cursorLeft() -> void;
   auto cursorRight() -> void;
   auto openFile(const std::string &) -> void;
+  // the view changes on its own while playing, so the main loop keeps redrawing
+  auto isAnimating() const -> bool;
 
 private:
   const int version = 1;
@@ -37,35 +53,92 @@ private:
   FileSaveAs fileSaveAs;
   FileSaveAs exportWavDlg;
   std::vector<float> wavData;
-  std::map<int, std::tuple<std::span<float>, int>> grains;
+  uint64_t wavHash = 0;
+  GrainIndex grains;
   int sampleRate = 0;
-  std::vector<std::vector<std::pair<float, float>>> picks;
+  MinMaxIndex minMaxIndex;
   double startTime = 0.;
   double rangeTime = 10.;
   double startNote = 24.;
   float rangeNote = 60.f;
   mutable std::vector<std::pair<float, float>> waveformCache;
-  double cursorSec = 0.0;
-  bool isAudioPlaying = false;
+  // absolute pixel index of the first cached column and the zoom it was computed at
+  int waveformFirst = 0;
+  double waveformRangeTime = 0.;
+  std::vector<double> waveformTimes;
+  std::vector<int> waveformSamples;
+  // shared with the audio callback
+  std::atomic<double> cursorSec = 0.0;
+  std::atomic<bool> isAudioPlaying = false;
   bool followMode = false;
 
+  // set while a spectrum ready event sits in the SDL queue, so the workers push one per frame at most
+  std::atomic<bool> isSpecEventPending = false;
   std::unique_ptr<Spec> spec;
   float brightness = 50.f;
   float k = 0.01f;
+  int hopIdx = 3;
+  int specCacheMb = 256;
+  // WavFormat of the exported file
+  int exportFormatIdx = 0;
+  bool isExportDither = true;
+  SpecScale specScale = SpecScale::log;
   std::unique_ptr<sdl::Audio> audio;
   mutable std::unique_ptr<SpecCache> specCache;
   double displayCursor;
   Texture pianoTexture;
+  // height, startNote and rangeNote the piano texture was generated for
+  std::tuple<int, double, float> pianoKey;
+  // the spectrogram shader applies brightness and the colormap, so changing them does not reupload spectra
+  std::unique_ptr<Shader> specShader;
+  Texture colormapTexture;
+  Texture pitchBendTexture;
+  std::vector<float> pitchBends;
+  // retained geometry, every batch is rebuilt only when the values it depends on change
+  std::vector<Vertex> vertices;
+  VertexBuffer waveformVbo;
+  VertexBuffer tileVbo;
+  VertexBuffer pianoVbo;
+  float pianoWidth = 0.f;
+  VertexBuffer barsVbo;
+  std::tuple<double, double, float, float> barsKey;
+  VertexBuffer markersVbo;
+  std::tuple<double, double, double, float, float, int, ptrdiff_t> markersKey;
+  mutable int markersVersion = 0;
+  VertexBuffer scrubberVbo;
   std::vector<Marker> markers;
   std::vector<Marker>::iterator selectedMarker;
-  mutable std::unordered_map<int, double> sample2TimeCache;
-  mutable std::unordered_map<int, int> time2SampleCache;
-  mutable std::unordered_map<int, float> time2PitchBendCache;
+  // rebuilt by invalidateCache every time the markers change, the synth thread reads it as an RCU
+  // snapshot, so editing never blocks playback
+  mutable Rcu<TimeMap> timeMap;
   float tempo = 130.f;
   std::string saveName;
   float bias = 0.f;
-  std::vector<float> restWav;
-  std::span<float> prevGrain;
+  Resampler resampler;
+  std::atomic<ResamplerQuality> resamplerQuality = ResamplerQuality::cubic;
+
+  // playback: the synth thread renders grains ahead into the ring, the audio callback only copies
+  // from it; every seek bumps seekGen and the callback drops what was rendered for the previous one
+  static constexpr auto PlaybackAhead = 4096;
+  SpscRing playbackRing{1 << 15};
+  std::thread synthThread;
+  // guards the synth thread's waits: isAudioPlaying, seekGen and isSynthRunning change under it
+  std::mutex synthMutex;
+  std::condition_variable synthCv;
+  bool isSynthRunning = false;
+  std::vector<float> grainWav;
+  std::atomic<uint64_t> seekGen = 0;
+  // the seek the ring samples from synthValidFrom on were rendered for
+  std::atomic<uint64_t> synthGen = 0;
+  std::atomic<uint64_t> synthValidFrom = 0;
+  std::atomic<bool> isSynthDone = false;
+  // audio thread only
+  uint64_t playbackGen = 0;
+  std::atomic<float> callbackUs = 0.f;
+  std::atomic<float> maxCallbackUs = 0.f;
+  std::atomic<uint64_t> underruns = 0;
+  // the export running in the background, if any
+  std::unique_ptr<Exporter> exporter;
 
 public:
 #define SER_PROP_LIST   \
@@ -78,23 +151,29 @@ public:
   SER_DEF_PROPS()
 #undef SER_PROP_LIST
 private:
-  auto calcPicks() -> void;
   auto cleanup() -> void;
   auto drawMarkers() -> void;
   auto duration() const -> double;
   auto estimateGrainSize(int start) const -> int;
   auto exportWav(const std::string &) -> void;
-  auto getMinMaxFromRange(int start, int end) -> std::pair<float, float>;
-  auto getTex(double start) -> GLuint;
+  // shifts the waveform cache to start at the absolute pixel column first, returns true if it changed
+  auto updateWaveform(int first, int columnsNum, float width) -> bool;
+  // computes waveformCache[begin, end)
+  auto fillWaveform(int begin, int end, float width) -> void;
   auto importFile(const std::string &) -> void;
   auto invalidateCache() const -> void;
   auto loadAudioFile(const std::string &) -> void;
   auto loadMelonixFile(const std::string &) -> void;
   auto playback(float *, size_t) -> void;
   auto preproc() -> void;
-  auto process(double cursor, std::vector<float> &wav) -> double;
-  auto sample2Time(int) const -> double;
+  auto resetSpec() -> void;
+  // appends the grain at cursor to wav and returns its duration, a null wav only measures it; the cursor
+  // makes looking up consecutive grains cheap
+  auto process(const TimeMap &, GrainIndex::Cursor &, ResamplerQuality, double cursor, std::vector<float> *wav) const
+    -> double;
+  auto seek(double sec) -> void;
+  auto startSynth() -> void;
+  auto stopSynth() -> void;
+  auto synth() -> void;
   auto saveMelonixFile(std::string) -> void;
-  auto time2PitchBend(double) const -> float;
-  auto time2Sample(double) const -> int;
 };
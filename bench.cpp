@@ -0,0 +1,515 @@
+#include "bench.hpp"
+#include "fft.hpp"
+#include "grain-index.hpp"
+#include "kernels.hpp"
+#include "min-max-index.hpp"
+#include "resampler.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  auto measure(const char *name, int n, std::function<void(int)> fn) -> double
+  {
+    fn(0); // warm up
+    const auto t0 = std::chrono::steady_clock::now();
+    for (auto i = 0; i < n; ++i)
+      fn(i);
+    const auto t1 = std::chrono::steady_clock::now();
+    const auto ret = std::chrono::duration<double, std::micro>(t1 - t0).count() / n;
+    printf("%-32s %10.2f us\n", name, ret);
+    return ret;
+  }
+
+  auto syntheticWav(int sampleRate, int seconds) -> std::vector<float>
+  {
+    auto gen = std::mt19937{42};
+    auto noise = std::uniform_real_distribution<float>{-0.05f, 0.05f};
+    auto ret = std::vector<float>{};
+    ret.resize(sampleRate * seconds);
+    for (auto i = 0U; i < ret.size(); ++i)
+      ret[i] = 0.5f * sinf(2.f * 3.141592f * 220.f * i / sampleRate) + noise(gen);
+    return ret;
+  }
+
+  // the spectrum path before the switch to the real-input transform, kept as a reference point
+  class ComplexFft
+  {
+  public:
+    ComplexFft() : input(fftw_alloc_complex(SpectrSize)), output(fftw_alloc_complex(SpectrSize))
+    {
+      memset(input, 0, SpectrSize * sizeof(fftw_complex));
+      plan = fftw_plan_dft_1d(SpectrSize, input, output, FFTW_FORWARD, FFTW_MEASURE);
+    }
+    ~ComplexFft()
+    {
+      fftw_destroy_plan(plan);
+      fftw_free(input);
+      fftw_free(output);
+    }
+    auto spec(const std::vector<float> &wav, int start, int end) -> std::vector<float>
+    {
+      auto p = 0;
+      for (auto i = end - SpectrSize; i < end; ++i, ++p)
+      {
+        input[p][1] = 0;
+        if ((i >= static_cast<int>(wav.size()) || i < 0))
+        {
+          input[p][0] = 0;
+          continue;
+        }
+        if (i >= start)
+          input[p][0] = wav[i];
+        else
+          input[p][0] = expf(-2.5e-4f * (start - i)) * wav[i];
+      }
+      fftw_execute(plan);
+      std::vector<float> ret;
+      for (auto i = 0U; i < SpectrSize / 2; i++)
+        ret.push_back(
+          static_cast<float>(sqrt(output[i][0] * output[i][0] + output[i][1] * output[i][1]) / SpectrSize));
+      return ret;
+    }
+
+  private:
+    fftw_plan plan;
+    fftw_complex *input;
+    fftw_complex *output;
+  };
+
+  auto benchFft(const std::vector<float> &wav) -> void
+  {
+    printf("spectrum column, %d points\n", SpectrSize);
+    const auto n = 200;
+    const auto hop = 512;
+    auto sink = 0.f;
+
+    ComplexFft complexFft;
+    const auto c2c = measure("c2c double (previous)", n, [&](int i) {
+      const auto end = SpectrSize + i * hop;
+      sink += complexFft.spec(wav, end - hop, end)[100];
+    });
+
+    Fft fft;
+    auto out = std::vector<float>{};
+    out.resize(SpectrBins);
+    const auto r2c = measure("r2c float", n, [&](int i) {
+      const auto end = SpectrSize + i * hop;
+      fft.spec(wav, end - hop, end, out);
+      sink += out[100];
+    });
+
+    printf("speedup %.2fx (%g)\n\n", c2c / r2c, sink);
+  }
+
+  // the per-bin loops the kernels replaced, kept as reference points
+  auto magnitudeReference(const std::vector<float> &complex) -> std::vector<float>
+  {
+    std::vector<float> ret;
+    for (auto i = 0U; i < complex.size() / 2; i++)
+      ret.push_back(static_cast<float>(
+        sqrt(complex[2 * i] * complex[2 * i] + complex[2 * i + 1] * complex[2 * i + 1]) / SpectrSize));
+    return ret;
+  }
+
+  auto benchKernels() -> void
+  {
+    printf("spectrum column kernels, %d bins\n", SpectrBins);
+    const auto n = 2000;
+    auto gen = std::mt19937{42};
+    auto dist = std::uniform_real_distribution<float>{-1.f, 1.f};
+    auto complex = std::vector<float>{};
+    complex.resize(2 * SpectrBins);
+    for (auto &v : complex)
+      v = dist(gen) * 100.f;
+    auto sink = 0.f;
+
+    const auto magRef = measure("magnitude scalar (previous)", n, [&](int) {
+      sink += magnitudeReference(complex)[100];
+    });
+    auto mag = std::vector<float>{};
+    mag.resize(SpectrBins);
+    const auto magSimd = measure("magnitude simd", n, [&](int) {
+      magnitude(complex, 1.f / SpectrSize, mag);
+      sink += mag[100];
+    });
+    printf("speedup %.2fx\n", magRef / magSimd);
+
+    auto logRef = std::vector<float>{};
+    logRef.resize(SpectrBins);
+    const auto lRef = measure("log2 scalar (previous)", n, [&](int) {
+      std::transform(std::begin(mag), std::end(mag), std::begin(logRef), [](float v) {
+        return std::max(std::log2(v), -64.f);
+      });
+      sink += logRef[100];
+    });
+    auto logs = std::vector<float>{};
+    logs.resize(SpectrBins);
+    const auto lSimd = measure("log2 simd", n, [&](int) {
+      log2Floor(mag, -64.f, logs);
+      sink += logs[100];
+    });
+    auto maxError = 0.f;
+    for (auto i = 0U; i < logs.size(); ++i)
+      maxError = std::max(maxError, std::abs(logs[i] - logRef[i]));
+    printf("speedup %.2fx, max error %g (%g)\n\n", lRef / lSimd, maxError, sink);
+  }
+
+  // the power of two min/max pyramid with a recursive query the index replaced, kept as a reference point
+  class Picks
+  {
+  public:
+    Picks(const std::vector<float> &wav) : wav(wav)
+    {
+      auto lvl = 0U;
+      picks.push_back({});
+      for (auto i = 0U; i < wav.size() / 2; ++i)
+        picks[lvl].push_back(std::minmax(wav[i * 2], wav[i * 2 + 1]));
+      for (;;)
+      {
+        ++lvl;
+        if (wav.size() <= (1U << (lvl + 1)))
+          break;
+        picks.push_back({});
+        for (auto i = 0U; i < wav.size() / (1 << (lvl + 1)); ++i)
+        {
+          const auto min = std::min(picks[lvl - 1][i * 2].first, picks[lvl - 1][i * 2 + 1].first);
+          const auto max = std::max(picks[lvl - 1][i * 2].second, picks[lvl - 1][i * 2 + 1].second);
+          picks[lvl].push_back(std::make_pair(min, max));
+        }
+      }
+    }
+    auto query(int start, int end) const -> std::pair<float, float>
+    {
+      if (start >= end)
+        return {wav[start], wav[start]};
+      if (end - start == 1)
+        return {wav[start], wav[start]};
+      const auto lvl = static_cast<size_t>(std::log2(end - start));
+      const auto lvlStart = start / (1 << lvl);
+      auto minMax = [&]() {
+        if (lvl - 1 >= picks.size())
+          return std::pair{0.f, 0.f};
+        if (lvlStart >= static_cast<int>(picks[lvl - 1].size()))
+          return std::pair{0.f, 0.f};
+        return picks[lvl - 1][lvlStart];
+      }();
+      const auto leftEnd = lvlStart * (1 << lvl);
+      if (leftEnd >= start)
+      {
+        const auto leftMinMax = query(start, leftEnd);
+        minMax.first = std::min(minMax.first, leftMinMax.first);
+        minMax.second = std::max(minMax.second, leftMinMax.second);
+      }
+      const auto rightStart = (lvlStart + 1) * (1 << lvl);
+      if (rightStart < end)
+      {
+        const auto rightMinMax = query(rightStart, end);
+        minMax.first = std::min(minMax.first, rightMinMax.first);
+        minMax.second = std::max(minMax.second, rightMinMax.second);
+      }
+      return minMax;
+    }
+
+  private:
+    const std::vector<float> &wav;
+    std::vector<std::vector<std::pair<float, float>>> picks;
+  };
+
+  // one waveform redraw of a 4K wide window at zoom levels from one sample per pixel to the whole file
+  auto benchMinMax() -> void
+  {
+    const auto Width = 3840;
+    const auto wav = syntheticWav(44100, 300);
+    printf("waveform min/max, %d columns, %zu samples\n", Width, wav.size());
+    const auto picks = Picks{wav};
+    const auto index = MinMaxIndex{wav};
+    const auto n = 20;
+    auto sink = 0.f;
+    const auto maxSamplesPerPixel = static_cast<int>(wav.size() / Width);
+    for (auto spp = 1;; spp = std::min(spp * 4, maxSamplesPerPixel))
+    {
+      // start off the power of two grid, like a panned view
+      const auto offset = 12345 % std::max(1, static_cast<int>(wav.size()) - Width * spp);
+      char name[64];
+      snprintf(name, sizeof(name), "%d samples/px previous", spp);
+      const auto prev = measure(name, n, [&](int) {
+        for (auto x = 0; x < Width; ++x)
+          sink += picks.query(offset + x * spp, offset + (x + 1) * spp).second;
+      });
+      snprintf(name, sizeof(name), "%d samples/px index", spp);
+      const auto idx = measure(name, n, [&](int) {
+        for (auto x = 0; x < Width; ++x)
+          sink += index.query(offset + x * spp, offset + (x + 1) * spp).second;
+      });
+      printf("speedup %.2fx\n", prev / idx);
+      if (spp == maxSamplesPerPixel)
+        break;
+    }
+    printf("(%g)\n\n", sink);
+  }
+
+  // the zero crossing search before the index, walking the signal from the start, kept as a reference
+  // point and as the expected result
+  auto grainsPrevious(std::span<const float> wav, int preferredSize) -> GrainIndex
+  {
+    const auto isZeroCrossing = [&](int idx, int lookAround) {
+      if (idx < lookAround)
+        return false;
+      if (idx >= static_cast<int>(wav.size() - lookAround - 1))
+        return false;
+      for (int j = 0; j < lookAround; ++j)
+      {
+        if (wav[idx - j] >= 0)
+          return false;
+        if (wav[idx + 1 + j] < 0)
+          return false;
+      }
+      return true;
+    };
+    auto ret = GrainIndex{};
+    auto start = 0;
+    while (start < static_cast<int>(wav.size() - preferredSize - 1))
+    {
+      auto end = -1;
+      for (auto i = 0; i < preferredSize && end < 0; ++i)
+      {
+        const auto idx = start + preferredSize + (i % 2 == 0 ? i / 2 : -i / 2);
+        if (isZeroCrossing(idx, 7))
+          end = idx;
+      }
+      for (auto i = start + preferredSize + preferredSize / 2; i < static_cast<int>(wav.size() - 1) && end < 0;
+           ++i)
+        if (isZeroCrossing(i, 3))
+          end = i;
+      if (end < 0)
+        break;
+      ret.push(start, end - start, end - start - preferredSize);
+      start = end;
+    }
+    return ret;
+  }
+
+  auto isSameGrains(const GrainIndex &a, const GrainIndex &b) -> bool
+  {
+    if (a.size() != b.size())
+      return false;
+    for (auto i = size_t{0}; i < a.size(); ++i)
+      if (a.start(i) != b.start(i) || a.grainSize(i) != b.grainSize(i) || a.deviation(i) != b.deviation(i))
+        return false;
+    return true;
+  }
+
+  auto benchGrains() -> void
+  {
+    const auto PreferredSize = 1500;
+    const auto SampleRate = 44100;
+    printf("grain segmentation, %d samples preferred, %u threads\n",
+           PreferredSize,
+           std::thread::hardware_concurrency());
+    auto gen = std::mt19937{42};
+    auto noise = std::normal_distribution<float>{};
+    auto noisy = std::vector<float>(SampleRate * 60);
+    for (auto &v : noisy)
+      v = noise(gen);
+    auto silent = std::vector<float>(SampleRate * 60);
+    auto periodic = std::vector<float>(SampleRate * 60);
+    for (auto i = 0U; i < periodic.size(); ++i)
+      periodic[i] = sinf(2.f * 3.141592f * 220.f * i / SampleRate);
+    for (const auto &[wav, name] : {std::make_pair(&noisy, "noisy"),
+                                    std::make_pair(&silent, "silent"),
+                                    std::make_pair(&periodic, "periodic")})
+    {
+      auto index = GrainIndex{};
+      index.build(*wav, PreferredSize);
+      const auto expected = grainsPrevious(*wav, PreferredSize);
+      printf("%-32s %zu grains, %s\n", name, expected.size(), isSameGrains(index, expected) ? "same" : "MISMATCH");
+    }
+
+    const auto wav = syntheticWav(SampleRate, 3600);
+    auto index = GrainIndex{};
+    const auto prev = measure("one hour previous", 1, [&](int) { index = grainsPrevious(wav, PreferredSize); });
+    const auto expected = index;
+    const auto idx = measure("one hour index", 1, [&](int) { index.build(wav, PreferredSize); });
+    printf("speedup %.2fx, %zu grains, %s\n\n",
+           prev / idx,
+           index.size(),
+           isSameGrains(index, expected) ? "same" : "MISMATCH");
+  }
+
+  // the playback loop before the resampler, linear interpolation with a modf per sample
+  auto resamplePrevious(std::span<const float> grain, float next, float rate, std::vector<float> &wav) -> void
+  {
+    for (auto i = 0;; ++i)
+    {
+      auto idxF = float{};
+      const auto curBias = std::modf(i * rate, &idxF);
+      const auto idx = static_cast<size_t>(idxF);
+      if (idx >= grain.size())
+        break;
+      wav.push_back((1.f - curBias) * grain[idx] + curBias * (idx + 1 < grain.size() ? grain[idx + 1] : next));
+    }
+  }
+
+  // the interpolation formulas the SIMD kernels implement, one output at a time
+  auto resampleCubicReference(std::span<const float> in, float rate, float bias, int first, std::span<float> out)
+    -> void
+  {
+    for (auto j = 0U; j < out.size(); ++j)
+    {
+      const auto pos = static_cast<float>(first + static_cast<int>(j)) * rate + bias;
+      const auto idx = static_cast<int>(pos);
+      const auto f = pos - static_cast<float>(idx);
+      const auto xm1 = in[idx - 1];
+      const auto x0 = in[idx];
+      const auto x1 = in[idx + 1];
+      const auto x2 = in[idx + 2];
+      out[j] = x0 + .5f * f * (x1 - xm1 + f * (2.f * xm1 - 5.f * x0 + 4.f * x1 - x2 + f * (3.f * (x0 - x1) + x2 - xm1)));
+    }
+  }
+
+  auto resampleFirReference(std::span<const float> in,
+                            float rate,
+                            float bias,
+                            int first,
+                            std::span<const float> table,
+                            int phases,
+                            int taps,
+                            std::span<float> out) -> void
+  {
+    for (auto j = 0U; j < out.size(); ++j)
+    {
+      const auto pos = static_cast<float>(first + static_cast<int>(j)) * rate + bias;
+      const auto idx = static_cast<int>(pos);
+      const auto row = table.subspan(static_cast<int>((pos - static_cast<float>(idx)) * phases + .5f) * taps, taps);
+      auto acc = 0.;
+      for (auto k = 0; k < taps; ++k)
+        acc += in[idx - taps / 2 + 1 + k] * row[k];
+      out[j] = static_cast<float>(acc);
+    }
+  }
+
+  auto maxError(std::span<const float> a, std::span<const float> b) -> float
+  {
+    auto ret = 0.f;
+    for (auto i = 0U; i < a.size(); ++i)
+      ret = std::max(ret, std::abs(a[i] - b[i]));
+    return ret;
+  }
+
+  // linear playback must not change a bit; the SIMD cubic and sinc kernels only reorder float operations
+  auto checkResample(const std::vector<float> &wav, float rate) -> void
+  {
+    const auto GrainSize = 1500;
+    const auto GrainsNum = 100;
+    const auto resampler = Resampler{};
+    const auto samples = std::span{wav};
+    auto expected = std::vector<float>{};
+    auto out = std::vector<float>{};
+    for (auto g = 1; g <= GrainsNum; ++g)
+    {
+      resamplePrevious(samples.subspan(g * GrainSize, GrainSize), wav[(g + 1) * GrainSize], rate, expected);
+      resampler.process(ResamplerQuality::linear,
+                        samples.subspan(g * GrainSize - Resampler::Context, Resampler::Context),
+                        samples.subspan(g * GrainSize, GrainSize),
+                        samples.subspan((g + 1) * GrainSize, Resampler::Context),
+                        rate,
+                        0.f,
+                        out);
+    }
+    const auto isLinearSame =
+      expected.size() == out.size() && memcmp(expected.data(), out.data(), out.size() * sizeof(float)) == 0;
+
+    const auto Taps = 16;
+    const auto Phases = 256;
+    auto gen = std::mt19937{42};
+    auto dist = std::uniform_real_distribution<float>{-.5f, .5f};
+    auto table = std::vector<float>((Phases + 1) * Taps);
+    for (auto &v : table)
+      v = dist(gen);
+    const auto first = Taps;
+    const auto n = static_cast<size_t>((wav.size() - 2 * Taps) / rate) - first;
+    const auto bias = .37f;
+    expected.resize(n);
+    out.resize(n);
+    resampleCubicReference(wav, rate, bias, first, expected);
+    resampleCubic(wav, rate, bias, first, out);
+    const auto cubicError = maxError(expected, out);
+    resampleFirReference(wav, rate, bias, first, table, Phases, Taps, expected);
+    resampleFir(wav, rate, bias, first, table, Phases, Taps, out);
+    const auto firError = maxError(expected, out);
+
+    const auto Tolerance = 1e-5f;
+    printf("rate %.2f linear %s, cubic max error %g%s, sinc max error %g%s\n",
+           rate,
+           isLinearSame ? "bit exact" : "MISMATCH",
+           cubicError,
+           cubicError <= Tolerance ? "" : " MISMATCH",
+           firError,
+           firError <= Tolerance ? "" : " MISMATCH");
+  }
+
+  auto benchResample(const std::vector<float> &wav) -> void
+  {
+    const auto GrainSize = 1500;
+    const auto GrainsNum = 100;
+    printf("grain resampling, %d grains of %d samples\n", GrainsNum, GrainSize);
+    const auto resampler = Resampler{};
+    const auto samples = std::span{wav};
+    auto out = std::vector<float>{};
+    auto sink = 0.f;
+    const auto n = 20;
+    for (const auto rate : {.75f, 1.25f})
+      checkResample(wav, rate);
+    for (const auto rate : {.75f, 1.25f})
+    {
+      char name[64];
+      snprintf(name, sizeof(name), "rate %.2f previous", rate);
+      const auto prev = measure(name, n, [&](int) {
+        out.clear();
+        for (auto g = 1; g <= GrainsNum; ++g)
+          resamplePrevious(samples.subspan(g * GrainSize, GrainSize), wav[(g + 1) * GrainSize], rate, out);
+        sink += out.back();
+      });
+      for (const auto &[quality, qualityName] : {std::make_pair(ResamplerQuality::linear, "linear"),
+                                               std::make_pair(ResamplerQuality::cubic, "cubic"),
+                                               std::make_pair(ResamplerQuality::sinc, "sinc")})
+      {
+        snprintf(name, sizeof(name), "rate %.2f %s", rate, qualityName);
+        const auto t = measure(name, n, [&](int) {
+          out.clear();
+          for (auto g = 1; g <= GrainsNum; ++g)
+            resampler.process(quality,
+                              samples.subspan(g * GrainSize - Resampler::Context, Resampler::Context),
+                              samples.subspan(g * GrainSize, GrainSize),
+                              samples.subspan((g + 1) * GrainSize, Resampler::Context),
+                              rate,
+                              0.f,
+                              out);
+          sink += out.back();
+        });
+        printf("speedup %.2fx\n", prev / t);
+      }
+    }
+    printf("(%g)\n\n", sink);
+  }
+} // namespace
+
+auto bench() -> int
+{
+  const auto wav = syntheticWav(44100, 10);
+  benchFft(wav);
+  benchKernels();
+  benchMinMax();
+  benchGrains();
+  benchResample(wav);
+  return 0;
+}
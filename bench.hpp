@@ -0,0 +1,4 @@
+#pragma once
+
+// micro-benchmarks for the hot loops, run with `melonix --bench`
+auto bench() -> int;
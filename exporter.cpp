@@ -0,0 +1,169 @@
+#include "exporter.hpp"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <log/log.hpp>
+
+Exporter::Exporter(const std::string &fileName,
+                   WavFormat format,
+                   bool isDither,
+                   const std::vector<Marker> &markers,
+                   TimeMap aTimeMap,
+                   const GrainIndex &grains,
+                   int sampleRate,
+                   Render render,
+                   int workersNum)
+  : fileName(fileName),
+    timeMap(std::move(aTimeMap)),
+    grains(grains),
+    render(std::move(render)),
+    wavWriter(fileName, sampleRate, format, isDither)
+{
+  if (!wavWriter.isOpen())
+  {
+    LOG("cannot open", fileName);
+    isFinished = true;
+    return;
+  }
+
+  const auto duration = timeMap.duration();
+  auto cuts = std::vector<double>{0., duration};
+  for (const auto &marker : markers)
+    cuts.push_back(timeMap.sample2Time(marker.sample));
+  std::sort(std::begin(cuts), std::end(cuts));
+  cuts.erase(std::unique(std::begin(cuts), std::end(cuts)), std::end(cuts));
+  auto targets = std::vector<double>{};
+  for (auto i = 0U; i + 1 < cuts.size(); ++i)
+  {
+    if (cuts[i] < 0. || cuts[i + 1] > duration)
+      continue;
+    const auto n = std::max(1, static_cast<int>(std::ceil((cuts[i + 1] - cuts[i]) / MaxSegmentTime)));
+    for (auto j = 0; j < n; ++j)
+      targets.push_back(cuts[i] + (cuts[i + 1] - cuts[i]) * j / n);
+  }
+
+  // the same cursor steps as a serial render, a grain start closes the segment if it is the nearest one to
+  // the next target
+  auto grainCursor = GrainIndex::Cursor{grains};
+  auto target = std::begin(targets);
+  auto cursor = 0.;
+  segments.push_back(Segment{cursor, cursor, 0, {}});
+  for (;;)
+  {
+    const auto dt = this->render(timeMap, grainCursor, cursor, nullptr);
+    if (dt <= 0.)
+      break;
+    for (; target != std::end(targets) && *target <= cursor + dt / 2; ++target)
+      if (segments.back().grainsNum > 0)
+        segments.push_back(Segment{cursor, cursor, 0, {}});
+    cursor += dt;
+    segments.back().end = cursor;
+    ++segments.back().grainsNum;
+  }
+
+  workersNum = std::max(1, workersNum);
+  window = 2 * static_cast<size_t>(workersNum);
+  LOG("export", fileName, "segments", segments.size(), "workers", workersNum);
+  for (auto i = 0; i < workersNum; ++i)
+    workers.emplace_back(&Exporter::work, this);
+  writer = std::thread(&Exporter::write, this);
+}
+
+Exporter::~Exporter()
+{
+  cancel();
+  for (auto &worker : workers)
+    worker.join();
+  if (writer.joinable())
+    writer.join();
+}
+
+auto Exporter::progress() const -> float
+{
+  return progressValue;
+}
+
+auto Exporter::isDone() const -> bool
+{
+  return isFinished;
+}
+
+auto Exporter::cancel() -> void
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    isCanceled = true;
+  }
+  cv.notify_all();
+}
+
+auto Exporter::renderSegment(const Segment &segment) const -> std::vector<float>
+{
+  auto ret = std::vector<float>{};
+  auto grainCursor = GrainIndex::Cursor{grains};
+  auto cursor = segment.begin;
+  for (auto i = 0; i < segment.grainsNum; ++i)
+    cursor += render(timeMap, grainCursor, cursor, &ret);
+  return ret;
+}
+
+auto Exporter::work() -> void
+{
+  for (;;)
+  {
+    const auto idx = [&]() -> size_t {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&]() {
+        return isCanceled || nextSegment >= segments.size() || nextSegment < segmentsWritten + window;
+      });
+      if (isCanceled || nextSegment >= segments.size())
+        return segments.size();
+      return nextSegment++;
+    }();
+    if (idx >= segments.size())
+      return;
+
+    auto pcm = renderSegment(segments[idx]);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      segments[idx].pcm = std::move(pcm);
+      segments[idx].isReady = true;
+    }
+    cv.notify_all();
+  }
+}
+
+auto Exporter::write() -> void
+{
+  const auto duration = std::max(segments.back().end, 1e-9);
+  auto written = size_t{0};
+  for (; written < segments.size(); ++written)
+  {
+    auto pcm = std::vector<float>{};
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&]() { return isCanceled || segments[written].isReady; });
+      if (isCanceled)
+        break;
+      pcm = std::move(segments[written].pcm);
+    }
+    wavWriter.write(pcm);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      ++segmentsWritten;
+    }
+    cv.notify_all();
+    progressValue = static_cast<float>(std::min(1., segments[written].end / duration));
+  }
+
+  wavWriter.close();
+  if (written < segments.size())
+  {
+    LOG("export canceled", fileName);
+    std::filesystem::remove(fileName);
+  }
+  else
+    LOG("exported", fileName);
+  isFinished = true;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "grain-index.hpp"
+#include "marker.hpp"
+#include "time-map.hpp"
+#include "wav-writer.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Renders the timeline to a WAV file in the background. A walk over the grains that renders nothing finds
+// the cursor every grain starts at, and the timeline is cut at the grain starts nearest the markers and
+// every MaxSegmentTime. A grain renders the same given the time map and the cursor, so the segments render
+// independently on a pool of threads, sample for sample like one serial render, while the writer thread
+// streams them to disk in order.
+class Exporter
+{
+public:
+  // appends the grain at cursor to the pcm and returns its duration, or only returns the duration if the pcm
+  // is null
+  using Render = std::function<double(const TimeMap &, GrainIndex::Cursor &, double cursor, std::vector<float> *)>;
+
+  Exporter(const std::string &fileName,
+           WavFormat,
+           bool isDither,
+           const std::vector<Marker> &,
+           TimeMap,
+           const GrainIndex &,
+           int sampleRate,
+           Render,
+           int workersNum = static_cast<int>(std::thread::hardware_concurrency()) - 1);
+  // cancels the export if it is still running
+  ~Exporter();
+  // 0-1 share of the timeline written
+  auto progress() const -> float;
+  auto isDone() const -> bool;
+  // stops the workers and deletes the partial file
+  auto cancel() -> void;
+
+private:
+  // longer stretches between markers are split, so a session without markers still renders in parallel
+  static constexpr auto MaxSegmentTime = 10.;
+
+  struct Segment
+  {
+    // the cursors of the first grain and past the last one
+    double begin;
+    double end;
+    int grainsNum;
+    std::vector<float> pcm;
+    bool isReady = false;
+  };
+
+  std::string fileName;
+  TimeMap timeMap;
+  const GrainIndex &grains;
+  Render render;
+  WavWriter wavWriter;
+  std::vector<Segment> segments;
+  // workers render at most this many segments ahead of the writer
+  size_t window;
+  std::mutex mutex;
+  std::condition_variable cv;
+  size_t nextSegment = 0;
+  size_t segmentsWritten = 0;
+  bool isCanceled = false;
+  std::atomic<float> progressValue = 0.f;
+  std::atomic<bool> isFinished = false;
+  std::vector<std::thread> workers;
+  std::thread writer;
+
+  auto work() -> void;
+  auto write() -> void;
+  auto renderSegment(const Segment &) const -> std::vector<float>;
+};
@@ -0,0 +1,59 @@
+#include "fft.hpp"
+#include "kernels.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+  auto fadeTable() -> const std::vector<float> &
+  {
+    static const auto ret = []() {
+      auto r = std::vector<float>{};
+      r.resize(SpectrSize + 1);
+      for (auto i = 0U; i < r.size(); ++i)
+        r[i] = expf(-2.5e-4f * i);
+      return r;
+    }();
+    return ret;
+  }
+} // namespace
+
+Fft::Fft() : input(fftwf_alloc_real(SpectrSize)), output(fftwf_alloc_complex(SpectrSize / 2 + 1))
+{
+  memset(input, 0, SpectrSize * sizeof(float));
+  memset(output, 0, (SpectrSize / 2 + 1) * sizeof(fftwf_complex));
+  // the FFTW planner is not thread-safe, construct Fft objects from one thread only
+  plan = fftwf_plan_dft_r2c_1d(SpectrSize, input, output, FFTW_MEASURE);
+}
+
+Fft::~Fft()
+{
+  fftwf_destroy_plan(plan);
+  fftwf_free(input);
+  fftwf_free(output);
+}
+
+auto Fft::spec(std::span<const float> wav, int start, int end, std::span<float> out) -> void
+{
+  assert(out.size() == SpectrBins);
+  const auto &fade = fadeTable();
+  const auto wavSize = static_cast<int>(wav.size());
+  auto p = 0;
+  for (auto i = end - SpectrSize; i < end; ++i, ++p)
+  {
+    if (i >= wavSize || i < 0)
+    {
+      input[p] = 0;
+      continue;
+    }
+    if (i >= start)
+      input[p] = wav[i];
+    else
+      input[p] = fade[std::min(start - i, SpectrSize)] * wav[i];
+  }
+  fftwf_execute(plan);
+  magnitude({reinterpret_cast<const float *>(output), 2 * SpectrBins}, 1.f / SpectrSize, out);
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <fftw3.h>
+#include <span>
+
+static const auto SpectrSize = 8 * 4096;
+static const auto SpectrBins = SpectrSize / 2;
+
+// Real-input FFT of the SpectrSize samples ending at `end`; samples before `start` fade out exponentially.
+class Fft
+{
+public:
+  Fft();
+  ~Fft();
+  Fft(const Fft &) = delete;
+  Fft &operator=(const Fft &) = delete;
+  auto spec(std::span<const float> wav, int start, int end, std::span<float> out) -> void;
+
+private:
+  fftwf_plan plan;
+  float *input;
+  fftwf_complex *output;
+};
@@ -0,0 +1,172 @@
+#include "grain-index.hpp"
+#include "kernels.hpp"
+#include "zero-crossings.hpp"
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+GrainIndex::Cursor::Cursor(const GrainIndex &index) : index(&index) {}
+
+auto GrainIndex::Cursor::lowerBound(int sample) -> size_t
+{
+  const auto &starts = index->starts;
+  const auto isLowerBound = [&](size_t i) {
+    return (i == starts.size() || starts[i] >= sample) && (i == 0 || starts[i - 1] < sample);
+  };
+  for (auto i = pos; i <= std::min(pos + 2, starts.size()); ++i)
+    if (isLowerBound(i))
+      return pos = i;
+  pos = index->lowerBound(sample);
+  return pos;
+}
+
+auto GrainIndex::clear() -> void
+{
+  starts.clear();
+  sizes.clear();
+  deviations.clear();
+}
+
+auto GrainIndex::push(int start, int size, int deviation) -> void
+{
+  starts.push_back(start);
+  sizes.push_back(size);
+  deviations.push_back(deviation);
+}
+
+auto GrainIndex::size() const -> size_t
+{
+  return starts.size();
+}
+
+auto GrainIndex::start(size_t i) const -> int
+{
+  return starts[i];
+}
+
+auto GrainIndex::grainSize(size_t i) const -> int
+{
+  return sizes[i];
+}
+
+auto GrainIndex::deviation(size_t i) const -> int
+{
+  return deviations[i];
+}
+
+auto GrainIndex::lowerBound(int sample) const -> size_t
+{
+  return static_cast<size_t>(std::lower_bound(std::begin(starts), std::end(starts), sample) - std::begin(starts));
+}
+
+namespace
+{
+  // shorter signals are segmented on one thread
+  const auto MinChunkSize = 1 << 18;
+
+  auto parallelFor(int n, const std::function<void(int)> &fn) -> void
+  {
+    auto threads = std::vector<std::thread>{};
+    for (auto i = 1; i < n; ++i)
+      threads.emplace_back(fn, i);
+    if (n > 0)
+      fn(0);
+    for (auto &thread : threads)
+      thread.join();
+  }
+} // namespace
+
+auto GrainIndex::build(std::span<const float> wav, int preferredSize) -> void
+{
+  clear();
+  const auto size = static_cast<int>(wav.size());
+  const auto chunksNum = std::clamp(size / MinChunkSize,
+                                    1,
+                                    std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+  // chunks are whole words, so threads never write to the same bitmap word
+  const auto wordsNum = (wav.size() + 63) / 64;
+  const auto chunkWords = (wordsNum + chunksNum - 1) / chunksNum;
+  auto negative = std::vector<uint64_t>(wordsNum);
+  auto nonNegative = std::vector<uint64_t>(wordsNum);
+  parallelFor(chunksNum, [&](int chunk) {
+    const auto begin = std::min(wordsNum, chunk * chunkWords);
+    const auto end = std::min(wordsNum, begin + chunkWords);
+    signBits(wav.subspan(begin * 64, std::min(wav.size(), end * 64) - begin * 64),
+             std::span{negative}.subspan(begin, end - begin),
+             std::span{nonNegative}.subspan(begin, end - begin));
+  });
+  const auto good = ZeroCrossings{negative, nonNegative, size, 7};
+  const auto bad = ZeroCrossings{negative, nonNegative, size, 3};
+  negative = {};
+  nonNegative = {};
+
+  // the start of the grain after the one at start, -1 if start is the last one: the good crossing nearest to
+  // start + preferredSize within half a grain, ties go forward, or else the first bad crossing past
+  // one and a half grains
+  const auto next = [&](int start) {
+    if (start >= static_cast<int>(wav.size() - preferredSize - 1))
+      return -1;
+    const auto center = start + preferredSize;
+    const auto forward = good.first(center, center + (preferredSize - 1) / 2 + 1);
+    const auto backward = good.last(center - (preferredSize - 2) / 2, center);
+    if (forward >= 0 && (backward < 0 || forward - center <= center - backward))
+      return forward;
+    if (backward >= 0)
+      return backward;
+    return bad.first(start + preferredSize + preferredSize / 2, size - 1);
+  };
+
+  // every chunk chains grains from its first good crossing; the real chain usually lands on one of those
+  // starts soon after entering the chunk, from there on the chains are the same
+  struct Chain
+  {
+    std::vector<int> starts;
+    bool isFinal = false;
+  };
+  auto chains = std::vector<Chain>(chunksNum);
+  const auto chunkSize = static_cast<int>(chunkWords * 64);
+  parallelFor(chunksNum, [&](int chunk) {
+    auto &chain = chains[chunk];
+    const auto end = chunk + 1 < chunksNum ? (chunk + 1) * chunkSize : size;
+    const auto seed = chunk == 0 ? 0 : good.first(chunk * chunkSize, end);
+    if (seed < 0)
+      return;
+    chain.starts.push_back(seed);
+    while (chain.starts.back() < end)
+    {
+      const auto n = next(chain.starts.back());
+      if (n < 0)
+      {
+        chain.isFinal = true;
+        break;
+      }
+      chain.starts.push_back(n);
+    }
+  });
+
+  // stitch: walk the real chain, jump to the end of a chunk chain as soon as they meet
+  auto start = 0;
+  auto chunk = 0;
+  const auto add = [&](int n) {
+    push(start, n - start, n - start - preferredSize);
+    start = n;
+  };
+  for (;;)
+  {
+    while (chunk + 1 < chunksNum && start >= (chunk + 1) * chunkSize)
+      ++chunk;
+    const auto &chain = chains[chunk];
+    const auto it = std::lower_bound(std::begin(chain.starts), std::end(chain.starts), start);
+    if (it != std::end(chain.starts) && *it == start)
+    {
+      std::for_each(it + 1, std::end(chain.starts), add);
+      if (chain.isFinal)
+        break;
+      continue;
+    }
+    const auto n = next(start);
+    if (n < 0)
+      break;
+    add(n);
+  }
+}
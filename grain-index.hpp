@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// Grains sorted by start sample, stored as flat arrays. Grains tile the audio, so playback looks up
+// neighbouring grains one after another; a Cursor remembers the last position and usually finds the
+// next grain in a step or two instead of a binary search.
+class GrainIndex
+{
+public:
+  class Cursor
+  {
+  public:
+    explicit Cursor(const GrainIndex &);
+    // same as GrainIndex::lowerBound
+    auto lowerBound(int sample) -> size_t;
+
+  private:
+    const GrainIndex *index;
+    size_t pos = 0;
+  };
+
+  // splits wav at zero crossings into grains of about preferredSize samples, the search runs in parallel
+  // chunks and gives the same grains as walking the signal from the start
+  auto build(std::span<const float> wav, int preferredSize) -> void;
+  auto clear() -> void;
+  // grains are added in increasing start order
+  auto push(int start, int size, int deviation) -> void;
+  auto size() const -> size_t;
+  auto start(size_t) const -> int;
+  auto grainSize(size_t) const -> int;
+  // the grain size minus the preferred grain size
+  auto deviation(size_t) const -> int;
+  // the first grain starting at or after sample, size() if there is none
+  auto lowerBound(int sample) const -> size_t;
+
+private:
+  std::vector<int> starts;
+  std::vector<int> sizes;
+  std::vector<int> deviations;
+};
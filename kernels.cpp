@@ -0,0 +1,630 @@
+#include "kernels.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MELONIX_X86 1
+#endif
+
+namespace
+{
+  auto magnitudeScalar(const float *complex, size_t n, float scale, float *out) -> void
+  {
+    for (auto i = 0U; i < n; ++i)
+      out[i] = sqrtf(complex[2 * i] * complex[2 * i] + complex[2 * i + 1] * complex[2 * i + 1]) * scale;
+  }
+
+  auto log2FloorScalar(const float *in, size_t n, float floor, float *out) -> void
+  {
+    const auto threshold = std::exp2(floor);
+    for (auto i = 0U; i < n; ++i)
+      out[i] = in[i] > threshold ? std::log2(in[i]) : floor;
+  }
+
+  auto minMaxScalar(const float *mins, const float *maxs, size_t n, std::pair<float, float> acc)
+    -> std::pair<float, float>
+  {
+    for (auto i = 0U; i < n; ++i)
+    {
+      acc.first = std::min(acc.first, mins[i]);
+      acc.second = std::max(acc.second, maxs[i]);
+    }
+    return acc;
+  }
+
+  auto signBitsScalar(const float *wav, size_t n, size_t word, uint64_t *negative, uint64_t *nonNegative) -> void
+  {
+    for (auto w = word; w * 64 < n; ++w)
+    {
+      auto neg = uint64_t{0};
+      auto nonNeg = uint64_t{0};
+      for (auto i = w * 64; i < std::min(n, w * 64 + 64); ++i)
+      {
+        neg |= static_cast<uint64_t>(!(wav[i] >= 0)) << (i % 64);
+        nonNeg |= static_cast<uint64_t>(!(wav[i] < 0)) << (i % 64);
+      }
+      negative[w] = neg;
+      nonNegative[w] = nonNeg;
+    }
+  }
+
+  // the interpolation position of output i, the same float arithmetic in every path
+  auto position(int i, float rate, float bias) -> float
+  {
+    return static_cast<float>(i) * rate + bias;
+  }
+
+  auto resampleLinearScalar(const float *in, float rate, float bias, int first, float *out, size_t n) -> void
+  {
+    for (auto j = 0U; j < n; ++j)
+    {
+      const auto pos = position(first + static_cast<int>(j), rate, bias);
+      const auto idx = static_cast<int>(pos);
+      const auto f = pos - static_cast<float>(idx);
+      out[j] = (1.f - f) * in[idx] + f * in[idx + 1];
+    }
+  }
+
+  auto cubic(float xm1, float x0, float x1, float x2, float f) -> float
+  {
+    const auto c1 = .5f * (x1 - xm1);
+    const auto c2 = xm1 - 2.5f * x0 + 2.f * x1 - .5f * x2;
+    const auto c3 = .5f * (x2 - xm1) + 1.5f * (x0 - x1);
+    return ((c3 * f + c2) * f + c1) * f + x0;
+  }
+
+  auto resampleCubicScalar(const float *in, float rate, float bias, int first, float *out, size_t n) -> void
+  {
+    for (auto j = 0U; j < n; ++j)
+    {
+      const auto pos = position(first + static_cast<int>(j), rate, bias);
+      const auto idx = static_cast<int>(pos);
+      out[j] = cubic(in[idx - 1], in[idx], in[idx + 1], in[idx + 2], pos - static_cast<float>(idx));
+    }
+  }
+
+  auto firRow(const float *table, int phases, int taps, float f) -> const float *
+  {
+    return table + static_cast<int>(f * phases + .5f) * taps;
+  }
+
+  auto resampleFirScalar(const float *in,
+                         float rate,
+                         float bias,
+                         int first,
+                         const float *table,
+                         int phases,
+                         int taps,
+                         float *out,
+                         size_t n) -> void
+  {
+    for (auto j = 0U; j < n; ++j)
+    {
+      const auto pos = position(first + static_cast<int>(j), rate, bias);
+      const auto idx = static_cast<int>(pos);
+      const auto row = firRow(table, phases, taps, pos - static_cast<float>(idx));
+      const auto x = in + idx - taps / 2 + 1;
+      auto acc = 0.f;
+      for (auto k = 0; k < taps; ++k)
+        acc += x[k] * row[k];
+      out[j] = acc;
+    }
+  }
+
+#ifdef MELONIX_X86
+  auto hasAvx2() -> bool
+  {
+    static const auto ret = __builtin_cpu_supports("avx2") != 0;
+    return ret;
+  }
+
+  auto magnitudeSse(const float *complex, size_t n, float scale, float *out) -> size_t
+  {
+    const auto s = _mm_set1_ps(scale);
+    auto i = size_t{0};
+    for (; i + 4 <= n; i += 4)
+    {
+      const auto a = _mm_loadu_ps(complex + 2 * i);
+      const auto b = _mm_loadu_ps(complex + 2 * i + 4);
+      const auto a2 = _mm_mul_ps(a, a);
+      const auto b2 = _mm_mul_ps(b, b);
+      const auto re2 = _mm_shuffle_ps(a2, b2, _MM_SHUFFLE(2, 0, 2, 0));
+      const auto im2 = _mm_shuffle_ps(a2, b2, _MM_SHUFFLE(3, 1, 3, 1));
+      _mm_storeu_ps(out + i, _mm_mul_ps(_mm_sqrt_ps(_mm_add_ps(re2, im2)), s));
+    }
+    return i;
+  }
+
+  __attribute__((target("avx2,fma"))) auto magnitudeAvx2(const float *complex, size_t n, float scale, float *out)
+    -> size_t
+  {
+    const auto s = _mm256_set1_ps(scale);
+    auto i = size_t{0};
+    for (; i + 8 <= n; i += 8)
+    {
+      const auto a = _mm256_loadu_ps(complex + 2 * i);
+      const auto b = _mm256_loadu_ps(complex + 2 * i + 8);
+      // the shuffles work per 128-bit lane, the result is re0 re1 re4 re5 re2 re3 re6 re7
+      const auto re = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+      const auto im = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+      const auto sum = _mm256_fmadd_ps(re, re, _mm256_mul_ps(im, im));
+      const auto ordered =
+        _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(sum), _MM_SHUFFLE(3, 1, 2, 0)));
+      _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_sqrt_ps(ordered), s));
+    }
+    return i;
+  }
+
+  // log2 of positive normal floats: the exponent plus an odd series in t = (m - 1) / (m + 1) for the mantissa
+  // m taken in [sqrt(1/2), sqrt(2)), |t| < 0.172 so four terms are accurate to about 1e-7
+  auto log2Sse(__m128 x) -> __m128
+  {
+    const auto bits = _mm_castps_si128(x);
+    auto e = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+    auto m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f800000)));
+    const auto isHigh = _mm_cmpgt_ps(m, _mm_set1_ps(1.41421356f));
+    m = _mm_or_ps(_mm_and_ps(isHigh, _mm_mul_ps(m, _mm_set1_ps(.5f))), _mm_andnot_ps(isHigh, m));
+    e = _mm_sub_epi32(e, _mm_castps_si128(isHigh));
+    const auto one = _mm_set1_ps(1.f);
+    const auto t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+    const auto t2 = _mm_mul_ps(t, t);
+    auto p = _mm_set1_ps(2.f / 7.f / 0.69314718f);
+    p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(2.f / 5.f / 0.69314718f));
+    p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(2.f / 3.f / 0.69314718f));
+    p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(2.f / 0.69314718f));
+    return _mm_add_ps(_mm_cvtepi32_ps(e), _mm_mul_ps(p, t));
+  }
+
+  auto log2FloorSse(const float *in, size_t n, float floor, float *out) -> size_t
+  {
+    const auto threshold = _mm_set1_ps(std::exp2(floor));
+    const auto f = _mm_set1_ps(floor);
+    auto i = size_t{0};
+    for (; i + 4 <= n; i += 4)
+    {
+      const auto x = _mm_loadu_ps(in + i);
+      // false for NaN, zero and negative input
+      const auto isValid = _mm_cmpgt_ps(x, threshold);
+      _mm_storeu_ps(out + i, _mm_or_ps(_mm_and_ps(isValid, log2Sse(x)), _mm_andnot_ps(isValid, f)));
+    }
+    return i;
+  }
+
+  __attribute__((target("avx2"))) auto log2Avx2(__m256 x) -> __m256
+  {
+    const auto bits = _mm256_castps_si256(x);
+    auto e = _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127));
+    auto m = _mm256_castsi256_ps(
+      _mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)), _mm256_set1_epi32(0x3f800000)));
+    const auto isHigh = _mm256_cmp_ps(m, _mm256_set1_ps(1.41421356f), _CMP_GT_OQ);
+    m = _mm256_blendv_ps(m, _mm256_mul_ps(m, _mm256_set1_ps(.5f)), isHigh);
+    e = _mm256_sub_epi32(e, _mm256_castps_si256(isHigh));
+    const auto one = _mm256_set1_ps(1.f);
+    const auto t = _mm256_div_ps(_mm256_sub_ps(m, one), _mm256_add_ps(m, one));
+    const auto t2 = _mm256_mul_ps(t, t);
+    auto p = _mm256_set1_ps(2.f / 7.f / 0.69314718f);
+    p = _mm256_add_ps(_mm256_mul_ps(p, t2), _mm256_set1_ps(2.f / 5.f / 0.69314718f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, t2), _mm256_set1_ps(2.f / 3.f / 0.69314718f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, t2), _mm256_set1_ps(2.f / 0.69314718f));
+    return _mm256_add_ps(_mm256_cvtepi32_ps(e), _mm256_mul_ps(p, t));
+  }
+
+  __attribute__((target("avx2"))) auto log2FloorAvx2(const float *in, size_t n, float floor, float *out) -> size_t
+  {
+    const auto threshold = _mm256_set1_ps(std::exp2(floor));
+    const auto f = _mm256_set1_ps(floor);
+    auto i = size_t{0};
+    for (; i + 8 <= n; i += 8)
+    {
+      const auto x = _mm256_loadu_ps(in + i);
+      const auto isValid = _mm256_cmp_ps(x, threshold, _CMP_GT_OQ);
+      _mm256_storeu_ps(out + i, _mm256_blendv_ps(f, log2Avx2(x), isValid));
+    }
+    return i;
+  }
+
+  auto minMaxSse(const float *mins, const float *maxs, size_t n, std::pair<float, float> &acc) -> size_t
+  {
+    auto lo = _mm_set1_ps(acc.first);
+    auto hi = _mm_set1_ps(acc.second);
+    auto i = size_t{0};
+    for (; i + 4 <= n; i += 4)
+    {
+      lo = _mm_min_ps(lo, _mm_loadu_ps(mins + i));
+      hi = _mm_max_ps(hi, _mm_loadu_ps(maxs + i));
+    }
+    alignas(16) float l[4];
+    alignas(16) float h[4];
+    _mm_store_ps(l, lo);
+    _mm_store_ps(h, hi);
+    acc.first = std::min(std::min(l[0], l[1]), std::min(l[2], l[3]));
+    acc.second = std::max(std::max(h[0], h[1]), std::max(h[2], h[3]));
+    return i;
+  }
+
+  __attribute__((target("avx2"))) auto minMaxAvx2(const float *mins,
+                                                  const float *maxs,
+                                                  size_t n,
+                                                  std::pair<float, float> &acc) -> size_t
+  {
+    auto lo = _mm256_set1_ps(acc.first);
+    auto hi = _mm256_set1_ps(acc.second);
+    auto i = size_t{0};
+    // two accumulators hide the latency of min/max
+    auto lo2 = lo;
+    auto hi2 = hi;
+    for (; i + 16 <= n; i += 16)
+    {
+      lo = _mm256_min_ps(lo, _mm256_loadu_ps(mins + i));
+      hi = _mm256_max_ps(hi, _mm256_loadu_ps(maxs + i));
+      lo2 = _mm256_min_ps(lo2, _mm256_loadu_ps(mins + i + 8));
+      hi2 = _mm256_max_ps(hi2, _mm256_loadu_ps(maxs + i + 8));
+    }
+    for (; i + 8 <= n; i += 8)
+    {
+      lo = _mm256_min_ps(lo, _mm256_loadu_ps(mins + i));
+      hi = _mm256_max_ps(hi, _mm256_loadu_ps(maxs + i));
+    }
+    lo = _mm256_min_ps(lo, lo2);
+    hi = _mm256_max_ps(hi, hi2);
+    const auto lo4 = _mm_min_ps(_mm256_castps256_ps128(lo), _mm256_extractf128_ps(lo, 1));
+    const auto hi4 = _mm_max_ps(_mm256_castps256_ps128(hi), _mm256_extractf128_ps(hi, 1));
+    alignas(16) float l[4];
+    alignas(16) float h[4];
+    _mm_store_ps(l, lo4);
+    _mm_store_ps(h, hi4);
+    acc.first = std::min(std::min(l[0], l[1]), std::min(l[2], l[3]));
+    acc.second = std::max(std::max(h[0], h[1]), std::max(h[2], h[3]));
+    return i;
+  }
+  // both return the number of complete 64 sample words done
+  auto signBitsSse(const float *wav, size_t n, uint64_t *negative, uint64_t *nonNegative) -> size_t
+  {
+    const auto zero = _mm_setzero_ps();
+    auto w = size_t{0};
+    for (; w * 64 + 64 <= n; ++w)
+    {
+      auto neg = uint64_t{0};
+      auto nonNeg = uint64_t{0};
+      for (auto i = 0; i < 64; i += 4)
+      {
+        const auto v = _mm_loadu_ps(wav + w * 64 + i);
+        neg |= static_cast<uint64_t>(_mm_movemask_ps(_mm_cmpnge_ps(v, zero))) << i;
+        nonNeg |= static_cast<uint64_t>(_mm_movemask_ps(_mm_cmpnlt_ps(v, zero))) << i;
+      }
+      negative[w] = neg;
+      nonNegative[w] = nonNeg;
+    }
+    return w;
+  }
+
+  __attribute__((target("avx2"))) auto signBitsAvx2(const float *wav,
+                                                    size_t n,
+                                                    uint64_t *negative,
+                                                    uint64_t *nonNegative) -> size_t
+  {
+    const auto zero = _mm256_setzero_ps();
+    auto w = size_t{0};
+    for (; w * 64 + 64 <= n; ++w)
+    {
+      auto neg = uint64_t{0};
+      auto nonNeg = uint64_t{0};
+      for (auto i = 0; i < 64; i += 8)
+      {
+        const auto v = _mm256_loadu_ps(wav + w * 64 + i);
+        neg |= static_cast<uint64_t>(_mm256_movemask_ps(_mm256_cmp_ps(v, zero, _CMP_NGE_UQ))) << i;
+        nonNeg |= static_cast<uint64_t>(_mm256_movemask_ps(_mm256_cmp_ps(v, zero, _CMP_NLT_UQ))) << i;
+      }
+      negative[w] = neg;
+      nonNegative[w] = nonNeg;
+    }
+    return w;
+  }
+  // the resample kernels return the number of outputs done
+  auto resampleLinearSse(const float *in, float rate, float bias, int first, float *out, size_t n) -> size_t
+  {
+    const auto r = _mm_set1_ps(rate);
+    const auto b = _mm_set1_ps(bias);
+    const auto one = _mm_set1_ps(1.f);
+    alignas(16) int32_t idx[4];
+    auto j = size_t{0};
+    for (; j + 4 <= n; j += 4)
+    {
+      const auto i = _mm_add_epi32(_mm_set1_epi32(first + static_cast<int>(j)), _mm_setr_epi32(0, 1, 2, 3));
+      const auto pos = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(i), r), b);
+      const auto idx4 = _mm_cvttps_epi32(pos);
+      const auto f = _mm_sub_ps(pos, _mm_cvtepi32_ps(idx4));
+      _mm_store_si128(reinterpret_cast<__m128i *>(idx), idx4);
+      const auto x0 = _mm_setr_ps(in[idx[0]], in[idx[1]], in[idx[2]], in[idx[3]]);
+      const auto x1 = _mm_setr_ps(in[idx[0] + 1], in[idx[1] + 1], in[idx[2] + 1], in[idx[3] + 1]);
+      _mm_storeu_ps(out + j, _mm_add_ps(_mm_mul_ps(_mm_sub_ps(one, f), x0), _mm_mul_ps(f, x1)));
+    }
+    return j;
+  }
+
+  __attribute__((target("avx2"))) auto resampleLinearAvx2(const float *in,
+                                                          float rate,
+                                                          float bias,
+                                                          int first,
+                                                          float *out,
+                                                          size_t n) -> size_t
+  {
+    const auto r = _mm256_set1_ps(rate);
+    const auto b = _mm256_set1_ps(bias);
+    const auto one = _mm256_set1_ps(1.f);
+    const auto steps = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    auto j = size_t{0};
+    for (; j + 8 <= n; j += 8)
+    {
+      const auto i = _mm256_add_epi32(_mm256_set1_epi32(first + static_cast<int>(j)), steps);
+      const auto pos = _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(i), r), b);
+      const auto idx = _mm256_cvttps_epi32(pos);
+      const auto f = _mm256_sub_ps(pos, _mm256_cvtepi32_ps(idx));
+      const auto x0 = _mm256_i32gather_ps(in, idx, 4);
+      const auto x1 = _mm256_i32gather_ps(in, _mm256_add_epi32(idx, _mm256_set1_epi32(1)), 4);
+      _mm256_storeu_ps(out + j, _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(one, f), x0), _mm256_mul_ps(f, x1)));
+    }
+    return j;
+  }
+
+  auto resampleCubicSse(const float *in, float rate, float bias, int first, float *out, size_t n) -> size_t
+  {
+    const auto r = _mm_set1_ps(rate);
+    const auto b = _mm_set1_ps(bias);
+    alignas(16) int32_t idx[4];
+    alignas(16) float f[4];
+    auto j = size_t{0};
+    for (; j + 4 <= n; j += 4)
+    {
+      const auto i = _mm_add_epi32(_mm_set1_epi32(first + static_cast<int>(j)), _mm_setr_epi32(0, 1, 2, 3));
+      const auto pos = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(i), r), b);
+      const auto idx4 = _mm_cvttps_epi32(pos);
+      _mm_store_si128(reinterpret_cast<__m128i *>(idx), idx4);
+      _mm_store_ps(f, _mm_sub_ps(pos, _mm_cvtepi32_ps(idx4)));
+      for (auto k = 0; k < 4; ++k)
+        out[j + k] = cubic(in[idx[k] - 1], in[idx[k]], in[idx[k] + 1], in[idx[k] + 2], f[k]);
+    }
+    return j;
+  }
+
+  __attribute__((target("avx2"))) auto resampleCubicAvx2(const float *in,
+                                                         float rate,
+                                                         float bias,
+                                                         int first,
+                                                         float *out,
+                                                         size_t n) -> size_t
+  {
+    const auto r = _mm256_set1_ps(rate);
+    const auto b = _mm256_set1_ps(bias);
+    const auto half = _mm256_set1_ps(.5f);
+    const auto oneHalf = _mm256_set1_ps(1.5f);
+    const auto two = _mm256_set1_ps(2.f);
+    const auto twoHalf = _mm256_set1_ps(2.5f);
+    const auto steps = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    auto j = size_t{0};
+    for (; j + 8 <= n; j += 8)
+    {
+      const auto i = _mm256_add_epi32(_mm256_set1_epi32(first + static_cast<int>(j)), steps);
+      const auto pos = _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(i), r), b);
+      const auto idx = _mm256_cvttps_epi32(pos);
+      const auto f = _mm256_sub_ps(pos, _mm256_cvtepi32_ps(idx));
+      const auto xm1 = _mm256_i32gather_ps(in, _mm256_sub_epi32(idx, _mm256_set1_epi32(1)), 4);
+      const auto x0 = _mm256_i32gather_ps(in, idx, 4);
+      const auto x1 = _mm256_i32gather_ps(in, _mm256_add_epi32(idx, _mm256_set1_epi32(1)), 4);
+      const auto x2 = _mm256_i32gather_ps(in, _mm256_add_epi32(idx, _mm256_set1_epi32(2)), 4);
+      const auto c1 = _mm256_mul_ps(half, _mm256_sub_ps(x1, xm1));
+      const auto c2 = _mm256_sub_ps(
+        _mm256_add_ps(_mm256_sub_ps(xm1, _mm256_mul_ps(twoHalf, x0)), _mm256_mul_ps(two, x1)), _mm256_mul_ps(half, x2));
+      const auto c3 =
+        _mm256_add_ps(_mm256_mul_ps(half, _mm256_sub_ps(x2, xm1)), _mm256_mul_ps(oneHalf, _mm256_sub_ps(x0, x1)));
+      const auto y = _mm256_add_ps(
+        _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(c3, f), c2), f), c1), f), x0);
+      _mm256_storeu_ps(out + j, y);
+    }
+    return j;
+  }
+
+  auto resampleFirSse(const float *in,
+                      float rate,
+                      float bias,
+                      int first,
+                      const float *table,
+                      int phases,
+                      int taps,
+                      float *out,
+                      size_t n) -> size_t
+  {
+    if (taps % 4 != 0)
+      return 0;
+    for (auto j = 0U; j < n; ++j)
+    {
+      const auto pos = position(first + static_cast<int>(j), rate, bias);
+      const auto idx = static_cast<int>(pos);
+      const auto row = firRow(table, phases, taps, pos - static_cast<float>(idx));
+      const auto x = in + idx - taps / 2 + 1;
+      auto acc = _mm_setzero_ps();
+      for (auto k = 0; k < taps; k += 4)
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(x + k), _mm_loadu_ps(row + k)));
+      acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+      acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+      out[j] = _mm_cvtss_f32(acc);
+    }
+    return n;
+  }
+
+  __attribute__((target("avx2,fma"))) auto resampleFirAvx2(const float *in,
+                                                          float rate,
+                                                          float bias,
+                                                          int first,
+                                                          const float *table,
+                                                          int phases,
+                                                          int taps,
+                                                          float *out,
+                                                          size_t n) -> size_t
+  {
+    if (taps % 8 != 0)
+      return 0;
+    for (auto j = 0U; j < n; ++j)
+    {
+      const auto pos = position(first + static_cast<int>(j), rate, bias);
+      const auto idx = static_cast<int>(pos);
+      const auto row = firRow(table, phases, taps, pos - static_cast<float>(idx));
+      const auto x = in + idx - taps / 2 + 1;
+      auto acc = _mm256_setzero_ps();
+      for (auto k = 0; k < taps; k += 8)
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(x + k), _mm256_loadu_ps(row + k), acc);
+      auto acc4 = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+      acc4 = _mm_add_ps(acc4, _mm_movehl_ps(acc4, acc4));
+      acc4 = _mm_add_ss(acc4, _mm_shuffle_ps(acc4, acc4, 1));
+      out[j] = _mm_cvtss_f32(acc4);
+    }
+    return n;
+  }
+#endif
+} // namespace
+
+auto magnitude(std::span<const float> complex, float scale, std::span<float> out) -> void
+{
+  assert(complex.size() >= 2 * out.size());
+  auto done = size_t{0};
+#ifdef MELONIX_X86
+  if (hasAvx2())
+    done = magnitudeAvx2(complex.data(), out.size(), scale, out.data());
+  else
+    done = magnitudeSse(complex.data(), out.size(), scale, out.data());
+#endif
+  magnitudeScalar(complex.data() + 2 * done, out.size() - done, scale, out.data() + done);
+}
+
+auto log2Floor(std::span<const float> in, float floor, std::span<float> out) -> void
+{
+  assert(in.size() == out.size());
+  auto done = size_t{0};
+#ifdef MELONIX_X86
+  if (hasAvx2())
+    done = log2FloorAvx2(in.data(), in.size(), floor, out.data());
+  else
+    done = log2FloorSse(in.data(), in.size(), floor, out.data());
+#endif
+  log2FloorScalar(in.data() + done, in.size() - done, floor, out.data() + done);
+}
+
+auto colormapLut() -> const std::array<uint32_t, 256> &
+{
+  static const auto ret = []() {
+    const auto rgba = [](int r, int g, int b) {
+      return static_cast<uint32_t>(r) | (static_cast<uint32_t>(g) << 8) | (static_cast<uint32_t>(b) << 16) |
+             0xff000000U;
+    };
+    auto r = std::array<uint32_t, 256>{};
+    for (auto i = 0; i < 256; ++i)
+    {
+      const auto tmp = static_cast<float>(i);
+      if (tmp < 255 / 3)
+        r[i] = rgba(i, 0, 0);
+      else if (tmp < 2 * 255 / 3)
+      {
+        const auto a = (tmp - 255 / 3) / (255 / 3) * 3.141592 / 2;
+        r[i] = rgba(static_cast<unsigned char>(tmp * std::cos(a)), static_cast<unsigned char>(tmp * std::sin(a)), 0);
+      }
+      else
+      {
+        const auto l_k = static_cast<unsigned char>((tmp - 2 * 255 / 3) * 3);
+        r[i] = rgba(l_k, i, l_k);
+      }
+    }
+    return r;
+  }();
+  return ret;
+}
+
+auto minMax(std::span<const float> mins, std::span<const float> maxs) -> std::pair<float, float>
+{
+  assert(mins.size() == maxs.size());
+  auto ret = std::make_pair(std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity());
+  auto done = size_t{0};
+#ifdef MELONIX_X86
+  if (hasAvx2())
+    done = minMaxAvx2(mins.data(), maxs.data(), mins.size(), ret);
+  else
+    done = minMaxSse(mins.data(), maxs.data(), mins.size(), ret);
+#endif
+  return minMaxScalar(mins.data() + done, maxs.data() + done, mins.size() - done, ret);
+}
+
+auto signBits(std::span<const float> wav, std::span<uint64_t> negative, std::span<uint64_t> nonNegative) -> void
+{
+  assert(negative.size() == (wav.size() + 63) / 64);
+  assert(nonNegative.size() == negative.size());
+  auto done = size_t{0};
+#ifdef MELONIX_X86
+  if (hasAvx2())
+    done = signBitsAvx2(wav.data(), wav.size(), negative.data(), nonNegative.data());
+  else
+    done = signBitsSse(wav.data(), wav.size(), negative.data(), nonNegative.data());
+#endif
+  signBitsScalar(wav.data(), wav.size(), done, negative.data(), nonNegative.data());
+}
+
+auto resampleLinear(std::span<const float> in, float rate, float bias, int first, std::span<float> out) -> void
+{
+  assert(out.empty() || static_cast<size_t>(position(first + static_cast<int>(out.size()) - 1, rate, bias)) + 1 <
+                          in.size());
+  auto done = size_t{0};
+#ifdef MELONIX_X86
+  if (hasAvx2())
+    done = resampleLinearAvx2(in.data(), rate, bias, first, out.data(), out.size());
+  else
+    done = resampleLinearSse(in.data(), rate, bias, first, out.data(), out.size());
+#endif
+  resampleLinearScalar(in.data(), rate, bias, first + static_cast<int>(done), out.data() + done, out.size() - done);
+}
+
+auto resampleCubic(std::span<const float> in, float rate, float bias, int first, std::span<float> out) -> void
+{
+  assert(out.empty() || (position(first, rate, bias) >= 1.f &&
+                         static_cast<size_t>(position(first + static_cast<int>(out.size()) - 1, rate, bias)) + 2 <
+                           in.size()));
+  auto done = size_t{0};
+#ifdef MELONIX_X86
+  if (hasAvx2())
+    done = resampleCubicAvx2(in.data(), rate, bias, first, out.data(), out.size());
+  else
+    done = resampleCubicSse(in.data(), rate, bias, first, out.data(), out.size());
+#endif
+  resampleCubicScalar(in.data(), rate, bias, first + static_cast<int>(done), out.data() + done, out.size() - done);
+}
+
+auto resampleFir(std::span<const float> in,
+                 float rate,
+                 float bias,
+                 int first,
+                 std::span<const float> table,
+                 int phases,
+                 int taps,
+                 std::span<float> out) -> void
+{
+  assert(table.size() == static_cast<size_t>((phases + 1) * taps));
+  assert(out.empty() ||
+         (static_cast<int>(position(first, rate, bias)) >= taps / 2 - 1 &&
+          static_cast<size_t>(position(first + static_cast<int>(out.size()) - 1, rate, bias)) + taps / 2 < in.size()));
+  auto done = size_t{0};
+#ifdef MELONIX_X86
+  if (hasAvx2())
+    done = resampleFirAvx2(in.data(), rate, bias, first, table.data(), phases, taps, out.data(), out.size());
+  else
+    done = resampleFirSse(in.data(), rate, bias, first, table.data(), phases, taps, out.data(), out.size());
+#endif
+  resampleFirScalar(in.data(),
+                    rate,
+                    bias,
+                    first + static_cast<int>(done),
+                    table.data(),
+                    phases,
+                    taps,
+                    out.data() + done,
+                    out.size() - done);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <span>
+#include <utility>
+
+// |z| * scale for interleaved complex input (re, im, re, im, ...); out holds complex.size() / 2 values
+auto magnitude(std::span<const float> complex, float scale, std::span<float> out) -> void;
+
+// out[i] = log2(in[i]) if in[i] > 2^floor, floor otherwise (NaN and non-positive input included); the SIMD
+// paths use a polynomial accurate to about 1e-6, well past the half floats the spectrogram textures keep
+auto log2Floor(std::span<const float> in, float floor, std::span<float> out) -> void;
+
+// RGBA (little-endian) colors for spectrogram intensities 0-255, the spectrogram shader's colormap texture
+auto colormapLut() -> const std::array<uint32_t, 256> &;
+
+// {min(mins), max(maxs)} for spans of the same size, {+inf, -inf} if they are empty; pass the same span
+// twice for raw samples
+auto minMax(std::span<const float> mins, std::span<const float> maxs) -> std::pair<float, float>;
+
+// bit i % 64 of negative[i / 64] is set unless wav[i] >= 0, of nonNegative[i / 64] unless wav[i] < 0, so NaN
+// sets both; the bitmaps hold (wav.size() + 63) / 64 words and the bits past the end are clear
+auto signBits(std::span<const float> wav, std::span<uint64_t> negative, std::span<uint64_t> nonNegative) -> void;
+
+// Grain resampling: out[j] interpolates in at pos = (first + j) * rate + bias, with idx = floor(pos) and
+// f = pos - idx; the caller keeps every tap inside in. Linear reads in[idx..idx + 1], the same arithmetic
+// as the original playback loop.
+auto resampleLinear(std::span<const float> in, float rate, float bias, int first, std::span<float> out) -> void;
+
+// cubic Hermite (Catmull-Rom) over in[idx - 1..idx + 2]
+auto resampleCubic(std::span<const float> in, float rate, float bias, int first, std::span<float> out) -> void;
+
+// polyphase FIR: table holds phases + 1 rows of taps coefficients, row round(f * phases) weights
+// in[idx - taps / 2 + 1..idx + taps / 2]
+auto resampleFir(std::span<const float> in,
+                 float rate,
+                 float bias,
+                 int first,
+                 std::span<const float> table,
+                 int phases,
+                 int taps,
+                 std::span<float> out) -> void;
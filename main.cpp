@@ -4,6 +4,7 @@
 // Read online: https://github.com/ocornut/imgui/tree/master/docs
 
 #include "app.hpp"
+#include "bench.hpp"
 #include "file-open.hpp"
 #include "imgui-impl-opengl3.h"
 #include "imgui-impl-sdl.h"
@@ -12,10 +13,14 @@
 #include <log/log.hpp>
 #include <sdlpp/sdlpp.hpp>
 #include <stdio.h>
+#include <string>
 
 // Main code
 int main(int argc, const char *argv[])
 {
+  if (argc > 1 && argv[1] == std::string{"--bench"})
+    return bench();
+
   // Setup SDL
   // (Some versions of SDL before <2.0.10 appears to have performance/stalling issues on a minority of Windows systems,
   // depending on whether SDL_INIT_GAMECONTROLLER is enabled or disabled.. updating to latest version of SDL is recommended!)
@@ -105,6 +110,9 @@ int main(int argc, const char *argv[])
   // Main loop
   bool done = false;
   App app;
+  const auto IdleTimeoutMs = 250;
+  const auto ExtraFrames = 2;
+  auto extraFrames = ExtraFrames;
 
   if (argc > 1)
     app.openFile(argv[1]);
@@ -117,8 +125,16 @@ int main(int argc, const char *argv[])
     // data.
     // - When io.WantCaptureKeyboard is true, do not dispatch keyboard input data to your main application, or clear/overwrite your copy of the
     // keyboard data. Generally you may always pass all inputs to dear imgui, and hide them from your application based on those two flags.
+    // Render on demand: while idle block until input arrives or a spectrum column gets ready, keep
+    // drawing a few more frames after an event, so ImGui can settle its hover and popup state.
     SDL_Event event;
-    while (SDL_PollEvent(&event))
+    auto hasEvent = (app.isAnimating() || extraFrames > 0) ? SDL_PollEvent(&event)
+                                                            : SDL_WaitEventTimeout(&event, IdleTimeoutMs);
+    if (hasEvent)
+      extraFrames = ExtraFrames;
+    else if (extraFrames > 0)
+      --extraFrames;
+    for (; hasEvent; hasEvent = SDL_PollEvent(&event))
     {
       switch (event.type)
       {
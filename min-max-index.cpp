@@ -0,0 +1,83 @@
+#include "min-max-index.hpp"
+#include "kernels.hpp"
+#include <algorithm>
+#include <limits>
+
+MinMaxIndex::MinMaxIndex(std::span<const float> wav) : wav(wav)
+{
+  auto mins = wav;
+  auto maxs = wav;
+  while (mins.size() >= BlockSize)
+  {
+    // a partial block at the end is never covered by a query as a whole, so it is not summarized
+    const auto n = mins.size() / BlockSize;
+    auto level = Level{};
+    level.mins.resize(n);
+    level.maxs.resize(n);
+    for (auto i = 0U; i < n; ++i)
+    {
+      const auto mm = minMax(mins.subspan(i * BlockSize, BlockSize), maxs.subspan(i * BlockSize, BlockSize));
+      level.mins[i] = mm.first;
+      level.maxs[i] = mm.second;
+    }
+    levels.push_back(std::move(level));
+    mins = levels.back().mins;
+    maxs = levels.back().maxs;
+  }
+}
+
+auto MinMaxIndex::query(int start, int end) const -> std::pair<float, float>
+{
+  const auto size = static_cast<int>(wav.size());
+  if (start >= end)
+  {
+    if (start >= 0 && start < size)
+      return {wav[start], wav[start]};
+    return {0.f, 0.f};
+  }
+  start = std::max(start, 0);
+  end = std::min(end, size);
+  if (start >= end)
+    return {0.f, 0.f};
+
+  auto ret = std::make_pair(std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity());
+  const auto add = [&ret](std::span<const float> mins, std::span<const float> maxs) {
+    // short runs do not pay for the SIMD setup and the horizontal reduction
+    if (mins.size() < 16)
+    {
+      for (auto i = 0U; i < mins.size(); ++i)
+      {
+        ret.first = std::min(ret.first, mins[i]);
+        ret.second = std::max(ret.second, maxs[i]);
+      }
+      return;
+    }
+    const auto mm = minMax(mins, maxs);
+    ret.first = std::min(ret.first, mm.first);
+    ret.second = std::max(ret.second, mm.second);
+  };
+
+  // [start, end) is in units of the current level, the values outside of whole blocks are scanned and
+  // the rest moves one level up
+  auto mins = wav;
+  auto maxs = wav;
+  for (auto lvl = 0U;; ++lvl)
+  {
+    const auto blockStart = (start + BlockSize - 1) / BlockSize;
+    const auto blockEnd = end / BlockSize;
+    // ranges of a couple of blocks are cheaper to scan in one go than to split
+    if (lvl >= levels.size() || end - start <= 2 * BlockSize)
+    {
+      add(mins.subspan(start, end - start), maxs.subspan(start, end - start));
+      return ret;
+    }
+    const auto headEnd = blockStart * BlockSize;
+    const auto tailStart = blockEnd * BlockSize;
+    add(mins.subspan(start, headEnd - start), maxs.subspan(start, headEnd - start));
+    add(mins.subspan(tailStart, end - tailStart), maxs.subspan(tailStart, end - tailStart));
+    start = blockStart;
+    end = blockEnd;
+    mins = levels[lvl].mins;
+    maxs = levels[lvl].maxs;
+  }
+}
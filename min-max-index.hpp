@@ -0,0 +1,29 @@
+#pragma once
+#include <span>
+#include <utility>
+#include <vector>
+
+// Min/max summaries of fixed blocks of BlockSize samples, then of BlockSize blocks and so on. A query
+// scans the partial blocks at both ends of the range level by level with SIMD, so it touches at most
+// 2 * BlockSize values per level and does not recurse.
+class MinMaxIndex
+{
+public:
+  static constexpr auto BlockSize = 64;
+
+  MinMaxIndex() = default;
+  explicit MinMaxIndex(std::span<const float> wav);
+  // min and max of wav[start, end) clipped to the data; an empty range returns the sample at start,
+  // {0, 0} outside of the data
+  auto query(int start, int end) const -> std::pair<float, float>;
+
+private:
+  std::span<const float> wav;
+  struct Level
+  {
+    std::vector<float> mins;
+    std::vector<float> maxs;
+  };
+  // levels[i] summarizes blocks of BlockSize^(i + 1) samples
+  std::vector<Level> levels;
+};
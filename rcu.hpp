@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Read-copy-update handoff of an immutable object from one writer thread to one reader thread. The
+// writer publishes a new version with an atomic pointer swap and never waits; the reader brackets its
+// accesses with a Reader, which bumps an epoch counter on entry and exit (odd = inside), so the writer
+// knows when a replaced version can no longer be in use and frees it on a later update.
+template <typename T>
+class Rcu
+{
+public:
+  class Reader
+  {
+  public:
+    explicit Reader(const Rcu &rcu) : rcu(rcu)
+    {
+      rcu.epoch.fetch_add(1);
+      value = rcu.current.load();
+    }
+    ~Reader() { rcu.epoch.fetch_add(1, std::memory_order_release); }
+    // disable copy
+    Reader(const Reader &) = delete;
+    Reader &operator=(const Reader &) = delete;
+
+    auto operator->() const -> const T * { return value; }
+    auto operator*() const -> const T & { return *value; }
+
+  private:
+    const Rcu &rcu;
+    const T *value;
+  };
+
+  Rcu() : current(new T{}) {}
+  ~Rcu()
+  {
+    for (auto &r : retired)
+      waitFor(r.second);
+    for (auto &r : retired)
+      delete r.first;
+    delete current.load();
+  }
+  // disable copy
+  Rcu(const Rcu &) = delete;
+  Rcu &operator=(const Rcu &) = delete;
+
+  // reader thread
+  auto read() const -> Reader { return Reader{*this}; }
+
+  // writer thread, it owns the current version and reads it without synchronization
+  auto operator->() const -> const T * { return current.load(std::memory_order_relaxed); }
+  auto operator*() const -> const T & { return *current.load(std::memory_order_relaxed); }
+
+  auto update(T value) -> void
+  {
+    const auto old = current.exchange(new T{std::move(value)});
+    retired.emplace_back(old, epoch.load());
+    // free the versions the reader cannot see anymore: it was outside when they got replaced or it
+    // has left that section since
+    auto it = std::begin(retired);
+    for (auto &r : retired)
+    {
+      if (r.second % 2 == 0 || epoch.load(std::memory_order_acquire) != r.second)
+        delete r.first;
+      else
+        *it++ = r;
+    }
+    retired.erase(it, std::end(retired));
+  }
+
+private:
+  std::atomic<const T *> current;
+  mutable std::atomic<uint64_t> epoch = 0;
+  // replaced versions with the reader epoch at the time of the swap
+  std::vector<std::pair<const T *, uint64_t>> retired;
+
+  auto waitFor(uint64_t e) const -> void
+  {
+    while (e % 2 != 0 && epoch.load(std::memory_order_acquire) == e)
+      std::this_thread::yield();
+  }
+};
@@ -0,0 +1,111 @@
+#include "resampler.hpp"
+#include "kernels.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numbers>
+
+Resampler::Resampler() : sincTables(SincLevels * (SincPhases + 1) * SincTaps)
+{
+  const auto pi = std::numbers::pi;
+  for (auto level = 0; level < SincLevels; ++level)
+  {
+    // a little below Nyquist, the Blackman window rolls off over the last few percent
+    const auto cutoff = .95 / std::exp2(level / 8.);
+    for (auto phase = 0; phase <= SincPhases; ++phase)
+    {
+      const auto row = sincTables.data() + (level * (SincPhases + 1) + phase) * SincTaps;
+      auto sum = 0.;
+      for (auto k = 0; k < SincTaps; ++k)
+      {
+        const auto x = k - SincTaps / 2 + 1 - 1. * phase / SincPhases;
+        const auto sinc = x == 0. ? 1. : std::sin(pi * cutoff * x) / (pi * cutoff * x);
+        const auto w = x / (SincTaps / 2);
+        const auto window = std::abs(w) >= 1. ? 0. : .42 + .5 * std::cos(pi * w) + .08 * std::cos(2 * pi * w);
+        row[k] = static_cast<float>(sinc * window);
+        sum += row[k];
+      }
+      // unity gain at DC for every phase
+      for (auto k = 0; k < SincTaps; ++k)
+        row[k] = static_cast<float>(row[k] / sum);
+    }
+  }
+}
+
+auto Resampler::outputSize(size_t size, float rate, float bias) -> int
+{
+  // the estimate is nudged by a step at most so the float rounding matches the kernels exactly
+  const auto end = static_cast<float>(size);
+  auto n = std::max(0, static_cast<int>(std::ceil((end - bias) / rate)));
+  while (n > 0 && (n - 1) * rate + bias >= end)
+    --n;
+  while (n * rate + bias < end)
+    ++n;
+  return n;
+}
+
+auto Resampler::sincTable(float rate) const -> std::span<const float>
+{
+  const auto level = std::clamp(static_cast<int>(std::lround(std::log2(rate) * 8)), 0, SincLevels - 1);
+  const auto tableSize = static_cast<size_t>((SincPhases + 1) * SincTaps);
+  return std::span{sincTables}.subspan(level * tableSize, tableSize);
+}
+
+auto Resampler::process(ResamplerQuality quality,
+                        std::span<const float> before,
+                        std::span<const float> grain,
+                        std::span<const float> after,
+                        float rate,
+                        float bias,
+                        std::vector<float> &out) const -> void
+{
+  const auto n = outputSize(grain.size(), rate, bias);
+  const auto table = quality == ResamplerQuality::sinc ? sincTable(rate) : std::span<const float>{};
+  // the taps around idx are [idx - left, idx + right]
+  const auto left = quality == ResamplerQuality::linear ? 0 : quality == ResamplerQuality::cubic ? 1 : SincTaps / 2 - 1;
+  const auto right = quality == ResamplerQuality::linear ? 1 : quality == ResamplerQuality::cubic ? 2 : SincTaps / 2;
+  const auto resample = [&](std::span<const float> in, float aRate, float aBias, int first, std::span<float> dst) {
+    switch (quality)
+    {
+    case ResamplerQuality::linear: resampleLinear(in, aRate, aBias, first, dst); break;
+    case ResamplerQuality::cubic: resampleCubic(in, aRate, aBias, first, dst); break;
+    case ResamplerQuality::sinc: resampleFir(in, aRate, aBias, first, table, SincPhases, SincTaps, dst); break;
+    }
+  };
+
+  const auto size = static_cast<int>(grain.size());
+  const auto idx = [&](int i) { return static_cast<int>(static_cast<float>(i) * rate + bias); };
+  auto begin = 0;
+  while (begin < n && idx(begin) < left)
+    ++begin;
+  auto end = n;
+  while (end > begin && idx(end - 1) + right >= size)
+    --end;
+
+  const auto first = out.size();
+  out.resize(first + n);
+  const auto dst = std::span{out}.subspan(first);
+  resample(grain, rate, bias, begin, dst.subspan(begin, end - begin));
+
+  // the outputs near the ends copy their taps into a small buffer; one extra tap covers the position
+  // rounding up to the next sample when it is offset by left
+  const auto at = [&](int k) {
+    if (k < 0)
+      return -k <= static_cast<int>(before.size()) ? before[before.size() + k] : 0.f;
+    if (k < size)
+      return grain[k];
+    return k - size < static_cast<int>(after.size()) ? after[k - size] : 0.f;
+  };
+  const auto edge = [&](int i) {
+    const auto pos = static_cast<float>(i) * rate + bias;
+    const auto j = static_cast<int>(pos);
+    auto taps = std::array<float, SincTaps + 1>{};
+    for (auto k = 0; k <= left + right + 1; ++k)
+      taps[k] = at(j - left + k);
+    resample(std::span{taps}.first(left + right + 2), 1.f, left + (pos - j), 0, dst.subspan(i, 1));
+  };
+  for (auto i = 0; i < begin; ++i)
+    edge(i);
+  for (auto i = end; i < n; ++i)
+    edge(i);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <vector>
+
+enum class ResamplerQuality
+{
+  linear,
+  cubic,
+  sinc
+};
+
+// Stretches a whole grain per call with the selected interpolation. Most outputs go straight to the SIMD
+// kernels over the grain, only the few near its ends gather their taps from the neighbouring audio. The
+// sinc tables are read-only once built, so one Resampler serves playback and the export workers at once.
+class Resampler
+{
+public:
+  // samples of context process() reads on either side of the grain at most
+  static constexpr auto Context = 9;
+
+  Resampler();
+  // the number of samples a grain of size samples stretches to: the first i with i * rate + bias >= size
+  static auto outputSize(size_t size, float rate, float bias) -> int;
+  // appends outputSize() samples of grain read at i * rate + bias; taps before the grain come from the end
+  // of before, taps past its end from the start of after (the grain that plays next), missing ones are zero
+  auto process(ResamplerQuality,
+               std::span<const float> before,
+               std::span<const float> grain,
+               std::span<const float> after,
+               float rate,
+               float bias,
+               std::vector<float> &out) const -> void;
+
+private:
+  static constexpr auto SincTaps = 16;
+  static constexpr auto SincPhases = 256;
+  // the cutoff follows the rate in eighths of an octave up to two octaves up, so pitching up does not alias
+  static constexpr auto SincLevels = 17;
+
+  // SincLevels tables of SincPhases + 1 rows of SincTaps coefficients
+  std::vector<float> sincTables;
+
+  auto sincTable(float rate) const -> std::span<const float>;
+};
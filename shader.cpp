@@ -0,0 +1,58 @@
+#include "shader.hpp"
+#include <log/log.hpp>
+#include <string>
+
+namespace
+{
+  auto compile(GLenum type, const char *source) -> GLuint
+  {
+    const auto ret = glCreateShader(type);
+    glShaderSource(ret, 1, &source, nullptr);
+    glCompileShader(ret);
+    auto status = GLint{};
+    glGetShaderiv(ret, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE)
+    {
+      auto log = std::string(1024, '\0');
+      glGetShaderInfoLog(ret, static_cast<GLsizei>(log.size()), nullptr, log.data());
+      LOG("shader compilation failed", log.c_str());
+    }
+    return ret;
+  }
+} // namespace
+
+Shader::Shader(const char *vertex, const char *fragment) : program(glCreateProgram())
+{
+  const auto vs = compile(GL_VERTEX_SHADER, vertex);
+  const auto fs = compile(GL_FRAGMENT_SHADER, fragment);
+  glAttachShader(program, vs);
+  glAttachShader(program, fs);
+  glLinkProgram(program);
+  auto status = GLint{};
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+  if (status != GL_TRUE)
+  {
+    auto log = std::string(1024, '\0');
+    glGetProgramInfoLog(program, static_cast<GLsizei>(log.size()), nullptr, log.data());
+    LOG("shader link failed", log.c_str());
+  }
+  glDetachShader(program, vs);
+  glDetachShader(program, fs);
+  glDeleteShader(vs);
+  glDeleteShader(fs);
+}
+
+Shader::~Shader()
+{
+  glDeleteProgram(program);
+}
+
+auto Shader::use() const -> void
+{
+  glUseProgram(program);
+}
+
+auto Shader::uniform(const char *name) const -> GLint
+{
+  return glGetUniformLocation(program, name);
+}
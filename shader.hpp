@@ -0,0 +1,24 @@
+#pragma once
+#include <imgui/imgui.h>
+
+#if defined(IMGUI_IMPL_OPENGL_ES2)
+#include <SDL_opengles2.h>
+#else
+#include <SDL_opengl.h>
+#endif
+
+class Shader
+{
+public:
+  Shader(const char *vertex, const char *fragment);
+  ~Shader();
+  // disable copy
+  Shader(const Shader &) = delete;
+  Shader &operator=(const Shader &) = delete;
+
+  auto use() const -> void;
+  auto uniform(const char *name) const -> GLint;
+
+private:
+  GLuint program;
+};
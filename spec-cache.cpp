@@ -1,116 +1,173 @@
 #include "spec-cache.hpp"
+#include "kernels.hpp"
 #include <algorithm>
 #include <cmath>
 
-SpecCache::SpecCache(Spec &spec, float k, int screenWidth, double rangeTime, std::function<int(double)> time2Sample)
-  : spec(spec), k(k), width(screenWidth), rangeTime(rangeTime), time2Sample(std::move(time2Sample))
+SpecCache::SpecCache(Spec &spec,
+                     int screenWidth,
+                     double rangeTime,
+                     int hop,
+                     std::function<int(double)> time2Sample)
+  : spec(spec),
+    bins(specBins(spec.getScale())),
+    width(screenWidth),
+    rangeTime(rangeTime),
+    hop(hop),
+    time2Sample(std::move(time2Sample)),
+    generation(spec.newGeneration()),
+    data(bins)
 {
+  auto maxSize = GLint{0};
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+  while (bins > binsPerTexel * maxSize)
+    binsPerTexel *= 2;
+  height = (bins + binsPerTexel - 1) / binsPerTexel;
+  maxTiles = 2 * static_cast<size_t>(screenWidth / TileWidth + 2);
+  glGenFramebuffers(1, &clearFbo);
 }
 
-auto SpecCache::getTex(double start) -> GLuint
+SpecCache::~SpecCache()
+{
+  glDeleteFramebuffers(1, &clearFbo);
+}
+
+auto SpecCache::getTile(int tileIdx) -> GLuint
 {
-  const auto key = static_cast<int>(start * width / rangeTime);
   {
-    const auto it = range2Tex.find(key);
-    if (it != std::end(range2Tex))
+    const auto it = tiles.find(tileIdx);
+    if (it != std::end(tiles))
     {
       age.erase(it->second.age);
-      age.push_front(key);
+      age.push_front(tileIdx);
       it->second.age = std::begin(age);
 
-      return populateTex(it->second.texture, it->second.isDirty, key);
+      return populateTile(tileIdx, it->second, false);
     }
   }
 
+  if (tiles.size() < maxTiles)
   {
-    if (range2Tex.size() < MaxRanges)
-    {
-      age.push_front(key);
-      auto tmp = range2Tex.insert(std::make_pair(key, Tex{std::begin(age)}));
-      auto retIt = tmp.first;
-      return populateTex(retIt->second.texture.get(), retIt->second.isDirty, key);
-    }
-    // recycle textures
-    // get the oldest texture
-    auto oldest = std::end(age);
-    --oldest;
-
-    age.erase(oldest);
+    age.push_front(tileIdx);
+    auto tmp = tiles.insert(std::make_pair(tileIdx, Tile{std::begin(age)}));
+    return populateTile(tileIdx, tmp.first->second, true);
+  }
 
-    const auto oldestKey = *oldest;
-    const auto retIt = range2Tex.find(oldestKey);
-    auto ret = std::move(retIt->second.texture);
-    range2Tex.erase(retIt);
+  // recycle the oldest tile
+  auto oldest = std::end(age);
+  --oldest;
+  const auto oldestIdx = *oldest;
+  age.erase(oldest);
 
-    age.push_front(key);
-    auto tmp = range2Tex.insert(std::make_pair(key, Tex{std::move(ret), std::begin(age)}));
+  const auto retIt = tiles.find(oldestIdx);
+  auto ret = std::move(retIt->second.texture);
+  tiles.erase(retIt);
 
-    return populateTex(tmp.first->second.texture.get(), tmp.first->second.isDirty, key);
-  }
+  age.push_front(tileIdx);
+  auto tmp = tiles.insert(std::make_pair(tileIdx, Tile{std::move(ret), std::begin(age)}));
+  return populateTile(tileIdx, tmp.first->second, true);
 }
 
-auto SpecCache::populateTex(GLuint texture, bool &isDirty, int key) -> GLuint
+auto SpecCache::populateTile(int tileIdx, Tile &tile, bool isNew) -> GLuint
 {
-  glBindTexture(GL_TEXTURE_1D, texture);
-  glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-
-  if (!isDirty)
+  glBindTexture(GL_TEXTURE_2D, tile.texture);
+  if (isNew)
   {
-    return texture;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, // target
+                 0,             // level
+                 GL_R16F,       // internalFormat
+                 TileWidth,     // width
+                 height,        // height
+                 0,             // border
+                 GL_RED,        // format
+                 GL_FLOAT,      // type
+                 nullptr);      // data
+    clearTile(tile.texture);
+    glBindTexture(GL_TEXTURE_2D, tile.texture);
   }
 
-  const auto start = key * rangeTime / width;
-  const auto pixelSize = rangeTime / width;
-  const auto s = spec.get().getSpec(time2Sample(start), time2Sample(start + pixelSize));
+  if (tile.dirtyNum == 0)
+    return tile.texture;
 
-  if (s.empty())
-  {
-    data.clear();
-    for (auto i = 0; i < 16; ++i)
-      data.push_back({static_cast<unsigned char>(0), static_cast<unsigned char>(0), static_cast<unsigned char>(0)});
-  }
-  else
+  const auto pixelSize = rangeTime / width;
+  // the focus moves every frame during playback; measuring the distance in whole tiles keeps the
+  // priorities of pending columns stable, so they are not rescheduled on every frame
+  const auto focusTile = static_cast<int>(std::floor(focus / (TileWidth * pixelSize)));
+  const auto priority = static_cast<double>(std::abs(tileIdx - focusTile));
+  for (auto x = 0; x < TileWidth; ++x)
   {
-    isDirty = false;
-    data.resize(s.size());
-    for (auto i = 0U; i < s.size(); ++i)
+    if (!tile.isDirty[x])
+      continue;
+    const auto start = (tileIdx * TileWidth + x) * pixelSize;
+    auto startSample = time2Sample(start);
+    auto endSample = time2Sample(start + pixelSize);
+    if (hop > 0)
     {
-      const auto tmp = std::clamp(s[i] * k, 0.f, 255.f);
-      if (tmp < 255 / 3)
-      {
-        data[i] = {static_cast<unsigned char>(tmp), 0, 0};
-      }
-      else if (tmp < 2 * 255 / 3)
-      {
-        const auto a = (tmp - 255 / 3) / (255 / 3) * 3.141592 / 2;
-        const auto r = static_cast<unsigned char>(tmp * std::cos(a));
-        const auto g = static_cast<unsigned char>(tmp * std::sin(a));
-        data[i] = std::array<unsigned char, 3>{r, g, 0};
-      }
-      else
-      {
-        const auto l_k = static_cast<unsigned char>((tmp - 2 * 255 / 3) * 3);
-        data[i] = std::array<unsigned char, 3>{l_k, static_cast<unsigned char>(tmp), l_k};
-      }
+      auto h = hop;
+      while (h < endSample - startSample)
+        h *= 2;
+      endSample = static_cast<int>(std::lround(1. * endSample / h)) * h;
+      startSample = endSample - h;
     }
+    const auto column = spec.get().getSpec(startSample, endSample, priority, generation);
+    const auto s = column.data();
+    // the column stays silent until the spectrum is computed
+    if (s.empty())
+      continue;
+
+    tile.isDirty[x] = false;
+    --tile.dirtyNum;
+    log2Floor(s, Silence, data);
+    if (binsPerTexel > 1)
+      for (auto y = 0; y < height; ++y)
+        data[y] = *std::max_element(std::begin(data) + y * binsPerTexel,
+                                    std::begin(data) + std::min(bins, (y + 1) * binsPerTexel));
+    glTexSubImage2D(GL_TEXTURE_2D, // target
+                    0,             // level
+                    x,             // xoffset
+                    0,             // yoffset
+                    1,             // width
+                    height,        // height
+                    GL_RED,        // format
+                    GL_FLOAT,      // type
+                    data.data());  // data
   }
 
-  glTexImage1D(GL_TEXTURE_1D,                     // target
-               0,                                 // level
-               3,                                 // internalFormat
-               static_cast<GLsizei>(data.size()), // width
-               0,                                 // border
-               GL_RGB,                            // format
-               GL_UNSIGNED_BYTE,                  // type
-               data.data()                        // data
-  );
-
-  return texture;
+  return tile.texture;
+}
+
+auto SpecCache::clearTile(GLuint texture) -> void
+{
+  auto prevFbo = GLint{0};
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFbo);
+  GLfloat prevClearColor[4];
+  glGetFloatv(GL_COLOR_CLEAR_VALUE, prevClearColor);
+  const auto isScissor = glIsEnabled(GL_SCISSOR_TEST);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, clearFbo);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+  glDisable(GL_SCISSOR_TEST);
+  // float color buffers take the clear color unclamped
+  glClearColor(Silence, 0.f, 0.f, 0.f);
+  glClear(GL_COLOR_BUFFER_BIT);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(prevFbo));
+  glClearColor(prevClearColor[0], prevClearColor[1], prevClearColor[2], prevClearColor[3]);
+  if (isScissor)
+    glEnable(GL_SCISSOR_TEST);
 }
 
 auto SpecCache::clear() -> void
 {
-  range2Tex.clear();
+  tiles.clear();
   age.clear();
 }
+
+auto SpecCache::setFocus(double time) -> void
+{
+  focus = time;
+}
@@ -3,6 +3,7 @@
 #include "texture.hpp"
 #include <functional>
 #include <imgui/imgui.h>
+#include <list>
 
 #if defined(IMGUI_IMPL_OPENGL_ES2)
 #include <SDL_opengles2.h>
@@ -10,30 +11,60 @@
 #include <SDL_opengl.h>
 #endif
 
+// Keeps the spectrogram in a ring of 2D textures, every tile holds TileWidth screen columns at the
+// current zoom, so the whole screen is drawn with a few quads. Columns are keyed by their absolute
+// pixel index: start time * screen width / range time. The ring holds two screens worth of tiles, so
+// panning back and forth does not recompute them.
 class SpecCache
 {
 public:
-  SpecCache(Spec &, float k, int screenWidth, double rangeTime, std::function<int(double)> time2Sample);
-  auto getTex(double time) -> GLuint;
+  static constexpr auto TileWidth = 256;
+  // textures hold log2 of the magnitude, brightness and colors are applied by the spectrogram shader
+  static constexpr auto Silence = -64.f;
+
+  // hop > 0 snaps columns to a regular STFT grid, so columns narrower than a hop share one spectrum;
+  // wider columns use the smallest power of two multiple of the hop that covers them
+  SpecCache(Spec &, int screenWidth, double rangeTime, int hop, std::function<int(double)> time2Sample);
+  ~SpecCache();
+  SpecCache(const SpecCache &) = delete;
+  SpecCache &operator=(const SpecCache &) = delete;
+  // returns the texture holding the columns [tile * TileWidth, (tile + 1) * TileWidth), the texture
+  // width is TileWidth and its height covers all the bins
+  auto getTile(int tile) -> GLuint;
   auto clear() -> void;
+  // columns in tiles closer to the focus time are computed first
+  auto setFocus(double time) -> void;
 
 private:
   std::reference_wrapper<Spec> spec;
-  float k;
+  int bins;
+  // bins taller than GL_MAX_TEXTURE_SIZE are merged by powers of two, keeping the loudest one
+  int binsPerTexel = 1;
+  int height;
+  size_t maxTiles;
   int width;
   double rangeTime;
+  int hop;
   std::function<int(double)> time2Sample;
-  struct Tex
+  int generation;
+  double focus = 0.;
+  struct Tile
   {
-    explicit Tex(std::list<int>::iterator age) : age(std::move(age)) {}
-    explicit Tex(Texture &&texture, std::list<int>::iterator age) : texture(std::move(texture)), age(std::move(age)) {}
+    explicit Tile(std::list<int>::iterator age) : age(std::move(age)) {}
+    explicit Tile(Texture &&texture, std::list<int>::iterator age) : texture(std::move(texture)), age(std::move(age))
+    {
+    }
     Texture texture;
     std::list<int>::iterator age;
-    bool isDirty = true;
+    std::vector<bool> isDirty = std::vector<bool>(TileWidth, true);
+    int dirtyNum = TileWidth;
   };
-  std::unordered_map<int, Tex> range2Tex;
+  std::unordered_map<int, Tile> tiles;
   std::list<int> age;
-  std::vector<std::array<unsigned char, 3>> data;
+  std::vector<float> data;
+  // new and recycled tiles are cleared to silence by attaching them to this framebuffer
+  GLuint clearFbo = 0;
 
-  auto populateTex(GLuint texture, bool &isDirty, int key) -> GLuint;
+  auto clearTile(GLuint texture) -> void;
+  auto populateTile(int tileIdx, Tile &, bool isNew) -> GLuint;
 };
@@ -0,0 +1,145 @@
+#include "spec-lru.hpp"
+#include <algorithm>
+#include <cassert>
+
+SpecColumn::SpecColumn(std::atomic<int> &pins, std::span<const float> column) : pins(&pins), column(column)
+{
+  pins.fetch_add(1, std::memory_order_relaxed);
+}
+
+SpecColumn::~SpecColumn()
+{
+  if (pins)
+    pins->fetch_sub(1, std::memory_order_release);
+}
+
+SpecColumn::SpecColumn(SpecColumn &&other) : pins(other.pins), column(other.column)
+{
+  other.pins = nullptr;
+  other.column = {};
+}
+
+SpecColumn &SpecColumn::operator=(SpecColumn &&other)
+{
+  if (this == &other)
+    return *this;
+  if (pins)
+    pins->fetch_sub(1, std::memory_order_release);
+  pins = other.pins;
+  column = other.column;
+  other.pins = nullptr;
+  other.column = {};
+  return *this;
+}
+
+SpecLru::SpecLru(size_t budget, int columnSize)
+  : columnSize(columnSize),
+    slots(std::max<size_t>(1, budget / (columnSize * sizeof(float))), Slot{{}, -1, -1})
+{
+  // left uninitialized, the pages are committed as columns get filled
+  slab.reset(new float[slots.size() * columnSize]);
+  pinsNum.reset(new std::atomic<int>[slots.size()]);
+  for (auto i = 0U; i < slots.size(); ++i)
+    pinsNum[i] = 0;
+  for (auto i = static_cast<int>(slots.size()) - 1; i >= 0; --i)
+    freeSlots.push_back(i);
+  range2Slot.reserve(slots.size());
+}
+
+auto SpecLru::slot(Range range) const -> int
+{
+  const auto it = range2Slot.find(range);
+  if (it == std::end(range2Slot))
+    return -1;
+  return it->second;
+}
+
+auto SpecLru::touch(int slot) -> void
+{
+  if (head == slot)
+    return;
+  unlink(slot);
+  pushFront(slot);
+}
+
+auto SpecLru::insert(Range range) -> int
+{
+  assert(range2Slot.find(range) == std::end(range2Slot));
+  if (freeSlots.empty())
+  {
+    auto oldest = tail;
+    while (oldest >= 0 && pinsNum[oldest].load(std::memory_order_acquire) > 0)
+      oldest = slots[oldest].prev;
+    if (oldest < 0)
+      return -1;
+    range2Slot.erase(slots[oldest].range);
+    unlink(oldest);
+    freeSlots.push_back(oldest);
+    ++evictionsNum;
+  }
+  const auto ret = freeSlots.back();
+  freeSlots.pop_back();
+  slots[ret].range = range;
+  pushFront(ret);
+  range2Slot.emplace(range, ret);
+  return ret;
+}
+
+auto SpecLru::pins(int slot) -> std::atomic<int> &
+{
+  return pinsNum[slot];
+}
+
+auto SpecLru::erase(int slot) -> void
+{
+  range2Slot.erase(slots[slot].range);
+  unlink(slot);
+  freeSlots.push_back(slot);
+}
+
+auto SpecLru::column(int slot) -> std::span<float>
+{
+  return {slab.get() + static_cast<size_t>(slot) * columnSize, static_cast<size_t>(columnSize)};
+}
+
+auto SpecLru::capacity() const -> size_t
+{
+  return slots.size();
+}
+
+auto SpecLru::evictions() const -> uint64_t
+{
+  return evictionsNum;
+}
+
+auto SpecLru::bytesResident() const -> size_t
+{
+  return range2Slot.size() * columnSize * sizeof(float);
+}
+
+auto SpecLru::unlink(int slot) -> void
+{
+  auto &s = slots[slot];
+  if (s.prev >= 0)
+    slots[s.prev].next = s.next;
+  else
+    head = s.next;
+  if (s.next >= 0)
+    slots[s.next].prev = s.prev;
+  else
+    tail = s.prev;
+  s.prev = -1;
+  s.next = -1;
+}
+
+auto SpecLru::pushFront(int slot) -> void
+{
+  auto &s = slots[slot];
+  s.prev = -1;
+  s.next = head;
+  if (head >= 0)
+    slots[head].prev = slot;
+  head = slot;
+  if (tail < 0)
+    tail = slot;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "range.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// Read-only view of a cached spectrum column. The column is pinned in the cache and is not recycled
+// while the handle is alive; releasing the handle does not need the cache lock.
+class SpecColumn
+{
+public:
+  SpecColumn() = default;
+  SpecColumn(std::atomic<int> &pins, std::span<const float> column);
+  ~SpecColumn();
+  SpecColumn(const SpecColumn &) = delete;
+  SpecColumn &operator=(const SpecColumn &) = delete;
+  SpecColumn(SpecColumn &&);
+  SpecColumn &operator=(SpecColumn &&);
+
+  auto empty() const -> bool { return column.empty(); }
+  auto data() const -> std::span<const float> { return column; }
+
+private:
+  std::atomic<int> *pins = nullptr;
+  std::span<const float> column;
+};
+
+// Fixed-size spectrum columns stored in one slab that is allocated up front. Slots are chained into
+// an intrusive LRU list; once the byte budget is used up the least recently used unpinned slot is
+// recycled. Not thread-safe, except for releasing pins.
+class SpecLru
+{
+public:
+  SpecLru(size_t budget, int columnSize);
+  // the slot caching the range or -1
+  auto slot(Range) const -> int;
+  // marks the slot as the most recently used one
+  auto touch(int slot) -> void;
+  // the range must not be cached yet, the returned slot may be a recycled one; -1 if every slot is pinned
+  auto insert(Range) -> int;
+  auto pins(int slot) -> std::atomic<int> &;
+  auto erase(int slot) -> void;
+  auto column(int slot) -> std::span<float>;
+  auto capacity() const -> size_t;
+  auto evictions() const -> uint64_t;
+  auto bytesResident() const -> size_t;
+
+private:
+  struct Slot
+  {
+    Range range;
+    int prev;
+    int next;
+  };
+  int columnSize;
+  std::unique_ptr<float[]> slab;
+  std::unique_ptr<std::atomic<int>[]> pinsNum;
+  std::vector<Slot> slots;
+  std::vector<int> freeSlots;
+  std::unordered_map<Range, int, pair_hash> range2Slot;
+  int head = -1;
+  int tail = -1;
+  uint64_t evictionsNum = 0;
+
+  auto unlink(int slot) -> void;
+  auto pushFront(int slot) -> void;
+};
@@ -0,0 +1,221 @@
+#include "spec-pyramid.hpp"
+#include "fft.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <log/log.hpp>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+  const auto MinHop = 1024;
+  const auto LevelsNum = 8;
+  const auto Version = 2U;
+  const auto HeaderSize = 4096U;
+  // 8 bit log2 magnitude covering [2^MinLog2, 1)
+  const auto MinLog2 = -24.f;
+  const auto StepsPerOctave = 255.f / -MinLog2;
+
+  enum FrameState : uint8_t { empty, writing, ready };
+
+  struct Header
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t bins;
+    uint32_t scale;
+    uint64_t wavHash;
+    uint64_t wavSize;
+  };
+
+  auto quantize(float v) -> uint8_t
+  {
+    if (v <= 0.f)
+      return 0;
+    const auto q = (std::log2(v) - MinLog2) * StepsPerOctave;
+    return static_cast<uint8_t>(std::clamp(q + 0.5f, 0.f, 255.f));
+  }
+
+  auto dequantize(uint8_t v) -> float
+  {
+    if (v == 0)
+      return 0.f;
+    return std::exp2(v / StepsPerOctave + MinLog2);
+  }
+} // namespace
+
+auto SpecPyramid::hashWav(std::span<const float> wav) -> uint64_t
+{
+  auto ret = uint64_t{0xcbf29ce484222325};
+  for (auto v : wav)
+  {
+    auto bits = uint32_t{};
+    memcpy(&bits, &v, sizeof(bits));
+    ret = (ret ^ bits) * 0x100000001b3;
+  }
+  return ret ^ wav.size();
+}
+
+SpecPyramid::SpecPyramid(const std::string &path, std::span<const float> wav, uint64_t wavHash, SpecScale scale)
+{
+  if (scale == SpecScale::linear)
+  {
+    // one pooled bin per linear bin at the bottom, no wider than 1/8 of a semitone above
+    for (auto b = 0; b < SpectrBins; b += std::max(1, static_cast<int>(b * (std::exp2(1. / 96.) - 1.))))
+      binStart.push_back(b);
+  }
+  else
+  {
+    for (auto b = 0; b < LogBins; ++b)
+      binStart.push_back(b);
+  }
+  binStart.push_back(specBins(scale));
+  const auto bins = binStart.size() - 1;
+
+  auto offset = size_t{HeaderSize};
+  for (auto i = 0; i < LevelsNum; ++i)
+  {
+    const auto hop = MinHop << i;
+    const auto frames = wav.size() / hop + 2;
+    levels.push_back(Level{hop, frames, offset, offset + frames});
+    offset += frames * (bins + 1);
+  }
+
+  const auto fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+  {
+    LOG("failed to open spectrum cache", path);
+    return;
+  }
+
+  const auto isValid = [&]() {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) != offset)
+      return false;
+    auto header = Header{};
+    if (pread(fd, &header, sizeof(header), 0) != sizeof(header))
+      return false;
+    return memcmp(header.magic, "MLNXSPEC", sizeof(header.magic)) == 0 && header.version == Version &&
+           header.bins == bins && header.scale == static_cast<uint32_t>(scale) && header.wavHash == wavHash && header.wavSize == wav.size();
+  }();
+
+  if (!isValid)
+  {
+    LOG("building spectrum cache", path);
+    auto header = Header{};
+    memcpy(header.magic, "MLNXSPEC", sizeof(header.magic));
+    header.version = Version;
+    header.bins = static_cast<uint32_t>(bins);
+    header.scale = static_cast<uint32_t>(scale);
+    header.wavHash = wavHash;
+    header.wavSize = wav.size();
+    if (ftruncate(fd, 0) != 0 || ftruncate(fd, static_cast<off_t>(offset)) != 0 ||
+        pwrite(fd, &header, sizeof(header), 0) != sizeof(header))
+    {
+      LOG("failed to initialize spectrum cache", path);
+      ::close(fd);
+      return;
+    }
+  }
+
+  auto ptr = mmap(nullptr, offset, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (ptr == MAP_FAILED)
+  {
+    LOG("failed to map spectrum cache", path);
+    return;
+  }
+  data = static_cast<uint8_t *>(ptr);
+  size = offset;
+
+  // frames that were being written when the previous session ended have to be recomputed
+  for (const auto &level : levels)
+    std::replace(data + level.flagsOffset, data + level.flagsOffset + level.frames, uint8_t{writing}, uint8_t{empty});
+}
+
+SpecPyramid::~SpecPyramid()
+{
+  if (data)
+    munmap(data, size);
+}
+
+auto SpecPyramid::isOpen() const -> bool
+{
+  return data != nullptr;
+}
+
+auto SpecPyramid::frame(int start, int end) const -> std::optional<std::pair<size_t, size_t>>
+{
+  const auto hop = end - start;
+  if (!data || hop < MinHop || end <= 0 || end % hop != 0)
+    return std::nullopt;
+  for (auto i = 0U; i < levels.size(); ++i)
+  {
+    if (levels[i].hop != hop)
+      continue;
+    const auto idx = static_cast<size_t>(end / hop);
+    if (idx >= levels[i].frames)
+      return std::nullopt;
+    return std::make_pair(i, idx);
+  }
+  return std::nullopt;
+}
+
+auto SpecPyramid::load(int start, int end, std::span<float> spec) const -> bool
+{
+  const auto f = frame(start, end);
+  if (!f)
+    return false;
+  const auto &level = levels[f->first];
+  auto state = std::atomic_ref<uint8_t>{data[level.flagsOffset + f->second]};
+  if (state.load(std::memory_order_acquire) != ready)
+    return false;
+  const auto bins = binStart.size() - 1;
+  const auto column = data + level.dataOffset + f->second * bins;
+  for (auto i = 0U; i < bins; ++i)
+    std::fill(spec.data() + binStart[i], spec.data() + binStart[i + 1], dequantize(column[i]));
+  return true;
+}
+
+auto SpecPyramid::store(int start, int end, std::span<const float> spec) -> void
+{
+  const auto f = frame(start, end);
+  if (!f)
+    return;
+  const auto &level = levels[f->first];
+  auto state = std::atomic_ref<uint8_t>{data[level.flagsOffset + f->second]};
+  auto expected = uint8_t{empty};
+  if (!state.compare_exchange_strong(expected, writing, std::memory_order_acquire))
+    return;
+  const auto bins = binStart.size() - 1;
+  auto column = data + level.dataOffset + f->second * bins;
+  for (auto i = 0U; i < bins; ++i)
+    column[i] =
+      quantize(*std::max_element(spec.data() + binStart[i], spec.data() + binStart[i + 1]));
+  state.store(ready, std::memory_order_release);
+}
+
+auto SpecPyramid::nextMissing() -> std::optional<Range>
+{
+  if (!data)
+    return std::nullopt;
+  // coarse levels are cheap to fill and make zoomed out views instant
+  for (; missingLevel < levels.size(); ++missingLevel, missingFrame = 1)
+  {
+    const auto &level = levels[levels.size() - 1 - missingLevel];
+    for (; missingFrame < level.frames; ++missingFrame)
+    {
+      auto state = std::atomic_ref<uint8_t>{data[level.flagsOffset + missingFrame]};
+      if (state.load(std::memory_order_relaxed) != empty)
+        continue;
+      const auto end = static_cast<int>(missingFrame * level.hop);
+      ++missingFrame;
+      return Range{end - level.hop, end};
+    }
+  }
+  return std::nullopt;
+}
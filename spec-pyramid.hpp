@@ -0,0 +1,48 @@
+#pragma once
+#include "range.hpp"
+#include "spec-scale.hpp"
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+// Multi-resolution spectrogram kept in a memory-mapped sidecar file. Level N holds the STFT frames
+// with hop (MinHop << N), frame i covers the samples [(i - 1) * hop, i * hop). Linear columns are
+// max-pooled to a quasi-logarithmic frequency grid, log columns are stored as they are; values are
+// quantized to 8 bits. The file is keyed by a hash of the audio and the column layout, so it survives
+// across sessions and is rebuilt if either changes.
+class SpecPyramid
+{
+public:
+  // wavHash is hashWav(wav), computed once per load by the caller
+  SpecPyramid(const std::string &path, std::span<const float> wav, uint64_t wavHash, SpecScale);
+  ~SpecPyramid();
+  SpecPyramid(const SpecPyramid &) = delete;
+  SpecPyramid &operator=(const SpecPyramid &) = delete;
+
+  static auto hashWav(std::span<const float> wav) -> uint64_t;
+  auto isOpen() const -> bool;
+  // both return false/do nothing if the range is not a frame of one of the levels
+  auto load(int start, int end, std::span<float> spec) const -> bool;
+  auto store(int start, int end, std::span<const float> spec) -> void;
+  // the next frame nobody has computed yet, coarse levels first
+  auto nextMissing() -> std::optional<Range>;
+
+private:
+  struct Level
+  {
+    int hop;
+    size_t frames;
+    size_t flagsOffset;
+    size_t dataOffset;
+  };
+  std::vector<int> binStart;
+  std::vector<Level> levels;
+  uint8_t *data = nullptr;
+  size_t size = 0;
+  size_t missingLevel = 0;
+  size_t missingFrame = 1;
+
+  auto frame(int start, int end) const -> std::optional<std::pair<size_t, size_t>>;
+};
@@ -0,0 +1,52 @@
+#include "spec-scale.hpp"
+#include "fft.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+auto specBins(SpecScale scale) -> int
+{
+  return scale == SpecScale::log ? LogBins : SpectrBins;
+}
+
+LogScale::LogScale(int sampleRate)
+{
+  const auto note2Bin = [sampleRate](double note) {
+    return 55. * std::pow(2., (note - 24.) / 12.) / sampleRate * SpectrSize;
+  };
+  for (auto i = 0; i < LogBins; ++i)
+  {
+    const auto left = note2Bin(1. * i / LogBinsPerNote);
+    const auto right = note2Bin(1. * (i + 1) / LogBinsPerNote);
+    const auto center = note2Bin((i + .5) / LogBinsPerNote);
+    if (center >= SpectrBins - 1)
+    {
+      // above Nyquist
+      bins.push_back(Bin{0, -1, 0.f});
+      continue;
+    }
+    if (right - left < 1.)
+    {
+      const auto first = static_cast<int>(center);
+      bins.push_back(Bin{first, first, static_cast<float>(center - first)});
+      continue;
+    }
+    bins.push_back(Bin{static_cast<int>(left), std::min(static_cast<int>(std::ceil(right)), SpectrBins), 0.f});
+  }
+}
+
+auto LogScale::apply(std::span<const float> linear, std::span<float> log) const -> void
+{
+  assert(linear.size() == SpectrBins);
+  assert(log.size() == LogBins);
+  for (auto i = 0U; i < bins.size(); ++i)
+  {
+    const auto &bin = bins[i];
+    if (bin.last < bin.first)
+      log[i] = 0.f;
+    else if (bin.last == bin.first)
+      log[i] = (1.f - bin.frac) * linear[bin.first] + bin.frac * linear[bin.first + 1];
+    else
+      log[i] = *std::max_element(linear.data() + bin.first, linear.data() + bin.last);
+  }
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <span>
+#include <vector>
+
+enum class SpecScale { linear, log };
+
+static const auto LogBinsPerNote = 4;
+static const auto LogBins = 128 * LogBinsPerNote;
+
+// the number of values in a spectrum column
+auto specBins(SpecScale) -> int;
+
+// Resamples linear FFT magnitudes to LogBinsPerNote bins per semitone over notes 0-127, where note 24
+// is 55 Hz like in the piano roll. Bins narrower than an FFT bin interpolate, wider ones keep the
+// peak of the FFT bins they cover.
+class LogScale
+{
+public:
+  LogScale(int sampleRate);
+  auto apply(std::span<const float> linear, std::span<float> log) const -> void;
+
+private:
+  struct Bin
+  {
+    int first;
+    int last;
+    float frac;
+  };
+  std::vector<Bin> bins;
+};
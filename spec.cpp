@@ -1,106 +1,213 @@
 #include "spec.hpp"
+#include <algorithm>
 #include <cassert>
-#include <cmath>
-#include <cstring>
 #include <log/log.hpp>
 #include <optional>
 
-const auto SpectrSize = 8 * 4096;
+Spec::Spec(std::span<float> wav,
+           int sampleRate,
+           SpecScale scale,
+           std::unique_ptr<SpecPyramid> aPyramid,
+           size_t cacheBudget,
+           std::function<void()> onReady,
+           int workersNum)
+  : wav(wav),
+    scale(scale),
+    logScale(sampleRate),
+    pyramid(std::move(aPyramid)),
+    onReady(std::move(onReady)),
+    lru(cacheBudget, specBins(scale))
+{
+  slots.resize(lru.capacity());
+  workersNum = std::max(1, workersNum);
+  for (auto i = 0; i < workersNum; ++i)
+    workers.push_back(std::make_unique<Worker>());
+  for (auto &worker : workers)
+    worker->thread = std::thread(&Spec::run, this, std::ref(*worker));
+  if (pyramid)
+  {
+    builder = std::make_unique<Worker>();
+    builder->thread = std::thread(&Spec::build, this, std::ref(*builder));
+  }
+  LOG("spectrum workers", workersNum);
+}
+
+auto Spec::hasPyramid() const -> bool
+{
+  return pyramid != nullptr;
+}
+
+auto Spec::getScale() const -> SpecScale
+{
+  return scale;
+}
+
+auto Spec::stats() const -> Stats
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return Stats{hits, misses, lru.evictions(), lru.bytesResident()};
+}
 
-Spec::Spec(std::span<float> wav)
-  : wav(wav), input(fftw_alloc_complex(SpectrSize)), output(fftw_alloc_complex(SpectrSize)), running(true), thread(std::thread(&Spec::run, this))
+namespace
 {
-  memset(input, 0, SpectrSize * sizeof(fftw_complex));
-  memset(output, 0, SpectrSize * sizeof(fftw_complex));
-  plan = fftw_plan_dft_1d(SpectrSize, input, output, FFTW_FORWARD, FFTW_MEASURE);
+  auto jobsCmp = [](const auto &a, const auto &b) { return a.priority > b.priority; };
 }
 
-auto Spec::getSpec(int start, int end) const -> std::vector<float>
+auto Spec::getSpec(int start, int end, double priority, int gen) const -> SpecColumn
 {
   const auto key = std::make_pair(start, end);
   std::lock_guard<std::mutex> lock(mutex);
-  auto it = range2Spec.find(key);
-  if (it != std::end(range2Spec))
+  if (gen != generation)
+    return {};
+  const auto slot = lru.slot(key);
+  if (slot >= 0)
+  {
+    lru.touch(slot);
+    auto &s = slots[slot];
+    if (s.isReady)
+    {
+      ++hits;
+      return SpecColumn{lru.pins(slot), lru.column(slot)};
+    }
+    if (s.isPending && s.priority != priority)
+    {
+      // reschedule, the old heap entry becomes stale
+      s.priority = priority;
+      pushJob(Job{priority, key});
+    }
+    return {};
+  }
+  const auto newSlot = lru.insert(key);
+  if (newSlot < 0)
+    return {};
+  // a miss is counted once per scheduled column, not on every poll while it is pending
+  ++misses;
+  slots[newSlot] = S{priority, true, false};
+  pushJob(Job{priority, key});
+  return {};
+}
+
+auto Spec::newGeneration() -> int
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  ++generation;
+  for (const auto &job : jobs)
+  {
+    const auto slot = lru.slot(job.range);
+    if (slot >= 0 && slots[slot].isPending)
+    {
+      slots[slot].isPending = false;
+      lru.erase(slot);
+    }
+  }
+  jobs.clear();
+  return generation;
+}
+
+auto Spec::isStale(const Job &job) const -> bool
+{
+  const auto slot = lru.slot(job.range);
+  return slot < 0 || !slots[slot].isPending || slots[slot].priority != job.priority;
+}
+
+auto Spec::pushJob(Job job) const -> void
+{
+  jobs.push_back(job);
+  std::push_heap(std::begin(jobs), std::end(jobs), jobsCmp);
+  // rescheduling leaves stale entries behind, drop them once they outnumber the live ones
+  if (jobs.size() > 2 * MaxRanges)
   {
-    age.erase(it->second.age);
-    age.push_front(key);
-    it->second.age = std::begin(age);
-    return it->second.spec;
+    jobs.erase(std::remove_if(std::begin(jobs), std::end(jobs), [this](const auto &j) { return isStale(j); }),
+               std::end(jobs));
+    std::make_heap(std::begin(jobs), std::end(jobs), jobsCmp);
   }
-  jobs.insert(key);
-  age.push_front(key);
-  range2Spec.insert(std::make_pair(key, S{{}, std::begin(age)}));
-  if (range2Spec.size() > MaxRanges)
+  jobsCv.notify_one();
+}
+
+auto Spec::internalGetSpec(Worker &worker, int start, int end, std::span<float> spec) const -> void
+{
+  if (pyramid && pyramid->load(start, end, spec))
+    return;
+  if (scale == SpecScale::log)
   {
-    auto oldest = std::end(age);
-    --oldest;
-    range2Spec.erase(*oldest);
-    jobs.erase(*oldest);
-    age.pop_back();
+    worker.fft.spec(wav, start, end, worker.linear);
+    logScale.apply(worker.linear, spec);
   }
-  return {};
+  else
+    worker.fft.spec(wav, start, end, spec);
+  if (pyramid)
+    pyramid->store(start, end, spec);
 }
 
-auto Spec::internalGetSpec(int start, int end) const -> std::vector<float>
+auto Spec::build(Worker &worker) -> void
 {
-  auto p = 0;
-  for (auto i = end - SpectrSize; i < end; ++i, ++p)
+  const auto isRunning = [this]() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return running;
+  };
+  auto spec = std::vector<float>{};
+  spec.resize(specBins(scale));
+  while (isRunning())
   {
-    input[p][1] = 0;
-    if ((i >= static_cast<int>(wav.size()) || i < 0))
+    const auto frame = pyramid->nextMissing();
+    if (!frame)
     {
-      input[p][0] = 0;
-      continue;
+      LOG("spectrum cache is complete");
+      return;
     }
-    if (i >= start)
-      input[p][0] = wav[i];
-    else
-      input[p][0] = expf(-2.5e-4f * (start - i)) * wav[i];
+    internalGetSpec(worker, frame->first, frame->second, spec);
   }
-  fftw_execute(plan);
-  std::vector<float> ret;
-  for (auto i = 0U; i < SpectrSize / 2; i++)
-    ret.push_back(
-      static_cast<float>(sqrt(output[i][0] * output[i][0] + output[i][1] * output[i][1]) / SpectrSize));
-  return ret;
 }
 
-auto Spec::run() -> void
+auto Spec::run(Worker &worker) -> void
 {
-  while (running)
+  for (;;)
   {
-    const auto job = [&]() -> std::optional<Range> {
-      std::lock_guard<std::mutex> lock(mutex);
-      if (jobs.empty())
-        return std::nullopt;
-      auto key = *jobs.begin();
-      jobs.erase(key);
-      return key;
+    // the slot is pinned while the worker fills it, so it is neither recycled nor read meanwhile
+    const auto job = [&]() -> std::optional<std::pair<Range, int>> {
+      std::unique_lock<std::mutex> lock(mutex);
+      for (;;)
+      {
+        jobsCv.wait(lock, [&]() { return !running || !jobs.empty(); });
+        if (!running)
+          return std::nullopt;
+        std::pop_heap(std::begin(jobs), std::end(jobs), jobsCmp);
+        const auto next = jobs.back();
+        jobs.pop_back();
+        if (isStale(next))
+          continue;
+        const auto slot = lru.slot(next.range);
+        slots[slot].isPending = false;
+        lru.pins(slot).fetch_add(1, std::memory_order_relaxed);
+        return std::make_pair(next.range, slot);
+      }
     }();
 
     if (!job)
-    {
-      std::this_thread::sleep_for(std::chrono::milliseconds(20));
-      continue;
-    }
+      return;
 
-    auto spec = internalGetSpec(job->first, job->second);
+    const auto [range, slot] = *job;
+    internalGetSpec(worker, range.first, range.second, lru.column(slot));
 
     {
       std::lock_guard<std::mutex> lock(mutex);
-      auto it = range2Spec.find(*job);
-      if (it == std::end(range2Spec))
-        continue;
-      it->second.spec = spec;
+      slots[slot].isReady = true;
+      lru.pins(slot).fetch_sub(1, std::memory_order_release);
     }
+    if (onReady)
+      onReady();
   }
 }
 
 Spec::~Spec()
 {
-  running = false;
-  thread.join();
-  fftw_destroy_plan(plan);
-  fftw_free(input);
-  fftw_free(output);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    running = false;
+  }
+  jobsCv.notify_all();
+  for (auto &worker : workers)
+    worker->thread.join();
+  if (builder)
+    builder->thread.join();
 }
@@ -1,39 +1,94 @@
 #pragma once
+#include "fft.hpp"
 #include "range.hpp"
-#include <deque>
-#include <fftw3.h>
-#include <list>
+#include "spec-lru.hpp"
+#include "spec-pyramid.hpp"
+#include "spec-scale.hpp"
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <span>
 #include <thread>
-#include <unordered_set>
+#include <unordered_map>
 #include <vector>
 
 class Spec
 {
 public:
-  Spec(std::span<float> wav);
+  struct Stats
+  {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    size_t bytesResident;
+  };
+
+  Spec(std::span<float> wav,
+       int sampleRate,
+       SpecScale,
+       std::unique_ptr<SpecPyramid> pyramid,
+       size_t cacheBudget,
+       std::function<void()> onReady,
+       int workersNum = static_cast<int>(std::thread::hardware_concurrency()));
   ~Spec();
-  auto getSpec(int start, int end) const -> std::vector<float>;
+  auto hasPyramid() const -> bool;
+  auto getScale() const -> SpecScale;
+  auto stats() const -> Stats;
+  // lower priority values are computed first, jobs from older generations are dropped
+  // the column is empty while it is being computed
+  auto getSpec(int start, int end, double priority, int generation) const -> SpecColumn;
+  // cancels all pending jobs and returns the generation new requests should use
+  auto newGeneration() -> int;
 
 private:
+  // every worker owns its plan and buffers, so FFTs run without sharing any state
+  struct Worker
+  {
+    Fft fft;
+    // FFT output before the log scale resampling
+    std::vector<float> linear = std::vector<float>(SpectrBins);
+    std::thread thread;
+  };
+
   std::span<float> wav;
-  mutable fftw_plan plan;
-  mutable fftw_complex *input;
-  mutable fftw_complex *output;
-  std::atomic<bool> running{false};
+  SpecScale scale;
+  LogScale logScale;
+  bool running = true;
   mutable std::mutex mutex;
-  mutable std::unordered_set<Range, pair_hash> jobs;
-  std::thread thread;
+  mutable std::condition_variable jobsCv;
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::unique_ptr<SpecPyramid> pyramid;
+  // fills the pyramid in the background
+  std::unique_ptr<Worker> builder;
+  int generation = 0;
+  // called from the workers every time a column gets ready
+  std::function<void()> onReady;
+
+  struct Job
+  {
+    double priority;
+    Range range;
+  };
+  // min-heap on priority; a job is stale if its range got rescheduled, evicted or cancelled
+  mutable std::vector<Job> jobs;
 
   struct S
   {
-    std::vector<float> spec;
-    std::list<Range>::iterator age;
+    double priority;
+    bool isPending;
+    bool isReady;
   };
 
-  mutable std::unordered_map<Range, S, pair_hash> range2Spec;
-  mutable std::list<Range> age;
+  mutable SpecLru lru;
+  // indexed by the LRU slot
+  mutable std::vector<S> slots;
+  mutable uint64_t hits = 0;
+  mutable uint64_t misses = 0;
 
-  auto run() -> void;
-  auto internalGetSpec(int start, int end) const -> std::vector<float>;
+  auto isStale(const Job &) const -> bool;
+  auto pushJob(Job) const -> void;
+  auto build(Worker &) -> void;
+  auto run(Worker &) -> void;
+  auto internalGetSpec(Worker &, int start, int end, std::span<float> spec) const -> void;
 };
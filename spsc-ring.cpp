@@ -0,0 +1,48 @@
+#include "spsc-ring.hpp"
+#include <algorithm>
+#include <bit>
+
+SpscRing::SpscRing(size_t capacity) : data(std::bit_ceil(capacity)), mask(data.size() - 1) {}
+
+auto SpscRing::write(std::span<const float> v) -> size_t
+{
+  const auto h = head.load(std::memory_order_relaxed);
+  const auto t = tail.load(std::memory_order_acquire);
+  const auto n = std::min(v.size(), data.size() - static_cast<size_t>(h - t));
+  const auto start = static_cast<size_t>(h & mask);
+  const auto first = std::min(n, data.size() - start);
+  std::copy_n(v.data(), first, data.data() + start);
+  std::copy_n(v.data() + first, n - first, data.data());
+  head.store(h + n, std::memory_order_release);
+  return n;
+}
+
+auto SpscRing::writePos() const -> uint64_t
+{
+  return head.load(std::memory_order_relaxed);
+}
+
+auto SpscRing::read(std::span<float> v) -> size_t
+{
+  const auto t = tail.load(std::memory_order_relaxed);
+  const auto h = head.load(std::memory_order_acquire);
+  const auto n = std::min(v.size(), static_cast<size_t>(h - t));
+  const auto start = static_cast<size_t>(t & mask);
+  const auto first = std::min(n, data.size() - start);
+  std::copy_n(data.data() + start, first, v.data());
+  std::copy_n(data.data(), n - first, v.data() + first);
+  tail.store(t + n, std::memory_order_release);
+  return n;
+}
+
+auto SpscRing::skipTo(uint64_t pos) -> void
+{
+  const auto t = tail.load(std::memory_order_relaxed);
+  if (pos > t)
+    tail.store(std::min(pos, head.load(std::memory_order_acquire)), std::memory_order_release);
+}
+
+auto SpscRing::size() const -> size_t
+{
+  return static_cast<size_t>(head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire));
+}
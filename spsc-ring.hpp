@@ -0,0 +1,33 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Lock-free single producer single consumer ring of samples with a fixed capacity. Positions are
+// absolute sample counters, so the consumer can drop everything before a position the producer
+// published.
+class SpscRing
+{
+public:
+  // the capacity is rounded up to a power of two
+  explicit SpscRing(size_t capacity);
+
+  // producer side, returns the number of samples that fit
+  auto write(std::span<const float>) -> size_t;
+  auto writePos() const -> uint64_t;
+
+  // consumer side, returns the number of samples read
+  auto read(std::span<float>) -> size_t;
+  // drops the samples before pos
+  auto skipTo(uint64_t pos) -> void;
+
+  auto size() const -> size_t;
+
+private:
+  std::vector<float> data;
+  size_t mask;
+  // written by the producer and the consumer only, on separate cache lines
+  alignas(64) std::atomic<uint64_t> head = 0;
+  alignas(64) std::atomic<uint64_t> tail = 0;
+};
@@ -0,0 +1,99 @@
+#include "time-map.hpp"
+#include <algorithm>
+
+TimeMap::TimeMap(const std::vector<Marker> &markers, int sampleRate, size_t wavSize) : sampleRate(sampleRate)
+{
+  samples.reserve(markers.size());
+  times.reserve(markers.size());
+  pitchBends.reserve(markers.size());
+  maxTimes.reserve(markers.size());
+  auto prevSample = 0;
+  auto prevTime = 0.0;
+  for (const auto &marker : markers)
+  {
+    const auto rightTime = prevTime + 1.0 * (marker.sample - prevSample) / sampleRate + marker.dTime;
+    samples.push_back(marker.sample);
+    times.push_back(rightTime);
+    pitchBends.push_back(marker.pitchBend);
+    maxTimes.push_back(maxTimes.empty() ? rightTime : std::max(maxTimes.back(), rightTime));
+    prevSample = marker.sample;
+    prevTime = rightTime;
+  }
+  durationTime = sample2Time(static_cast<int>(wavSize - 1));
+}
+
+auto TimeMap::sample2Time(int val) const -> double
+{
+  if (val <= 0)
+    return 1. * val / sampleRate;
+
+  const auto i = static_cast<size_t>(std::lower_bound(std::begin(samples), std::end(samples), val) -
+                                     std::begin(samples));
+  const auto prevSample = i == 0 ? 0 : samples[i - 1];
+  const auto prevTime = i == 0 ? 0. : times[i - 1];
+  if (i == samples.size())
+    return prevTime + 1. * (val - prevSample) / sampleRate;
+  return prevTime + (val - prevSample) * (times[i] - prevTime) / (samples[i] - prevSample);
+}
+
+auto TimeMap::segment(double time) const -> size_t
+{
+  return static_cast<size_t>(std::lower_bound(std::begin(maxTimes), std::end(maxTimes), time) -
+                             std::begin(maxTimes));
+}
+
+auto TimeMap::segmentTime2Sample(size_t i, double val) const -> int
+{
+  const auto prevSample = i == 0 ? 0 : samples[i - 1];
+  const auto prevTime = i == 0 ? 0. : times[i - 1];
+  if (i == samples.size())
+    return static_cast<int>(prevSample + (val - prevTime) * sampleRate);
+  return static_cast<int>(prevSample + (val - prevTime) * (samples[i] - prevSample) / (times[i] - prevTime));
+}
+
+auto TimeMap::time2Sample(double val) const -> int
+{
+  if (val <= 0)
+    return static_cast<int>(val * sampleRate);
+  return segmentTime2Sample(segment(val), val);
+}
+
+auto TimeMap::time2Samples(std::span<const double> vals, std::span<int> out) const -> void
+{
+  auto i = size_t{0};
+  for (auto j = 0U; j < vals.size(); ++j)
+  {
+    const auto val = vals[j];
+    if (val <= 0)
+    {
+      out[j] = static_cast<int>(val * sampleRate);
+      continue;
+    }
+    while (i < maxTimes.size() && maxTimes[i] < val)
+      ++i;
+    out[j] = segmentTime2Sample(i, val);
+  }
+}
+
+auto TimeMap::time2PitchBend(double val) const -> float
+{
+  if (val <= 0)
+    return 0;
+
+  const auto i = segment(val);
+  const auto prevTime = i == 0 ? 0. : times[i - 1];
+  const auto prevPitchBend = i == 0 ? 0. : pitchBends[i - 1];
+  if (i < samples.size())
+    return static_cast<float>(prevPitchBend +
+                              (val - prevTime) * (pitchBends[i] - prevPitchBend) / (times[i] - prevTime));
+
+  // the bend of the last marker fades out towards the end of the audio
+  if (val > durationTime)
+    return 0;
+  return static_cast<float>(prevPitchBend + (val - prevTime) * (0 - prevPitchBend) / (durationTime - prevTime));
+}
+
+auto TimeMap::duration() const -> double
+{
+  return durationTime;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "marker.hpp"
+#include <span>
+#include <vector>
+
+// Piecewise linear mapping between samples and the warped timeline defined by the markers. The markers
+// are compiled into prefix arrays once, so every query is a binary search over the segments.
+class TimeMap
+{
+public:
+  TimeMap() = default;
+  // markers are sorted by sample
+  TimeMap(const std::vector<Marker> &, int sampleRate, size_t wavSize);
+  auto sample2Time(int) const -> double;
+  auto time2Sample(double) const -> int;
+  // time2Sample for non-decreasing times in a single pass over the segments
+  auto time2Samples(std::span<const double> times, std::span<int> samples) const -> void;
+  auto time2PitchBend(double) const -> float;
+  auto duration() const -> double;
+
+private:
+  int sampleRate = 44100;
+  // segment i ends at samples[i], times[i], pitchBends[i] and starts where segment i - 1 ends, the first
+  // one starts at zero; time past the last marker runs at the original speed
+  std::vector<int> samples;
+  std::vector<double> times;
+  std::vector<double> pitchBends;
+  // running maximum of times, negative dTime can make segments go backwards and the first segment
+  // containing a time is the first one whose end reaches it
+  std::vector<double> maxTimes;
+  double durationTime = 0.;
+
+  auto segment(double time) const -> size_t;
+  auto segmentTime2Sample(size_t, double time) const -> int;
+};
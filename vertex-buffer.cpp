@@ -0,0 +1,47 @@
+#include "vertex-buffer.hpp"
+#include <cstddef>
+
+VertexBuffer::VertexBuffer()
+{
+  glGenVertexArrays(1, &vao);
+  glGenBuffers(1, &vbo);
+  glBindVertexArray(vao);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glVertexPointer(2, GL_FLOAT, sizeof(Vertex), reinterpret_cast<const void *>(offsetof(Vertex, x)));
+  glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+  glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), reinterpret_cast<const void *>(offsetof(Vertex, s)));
+  glEnableClientState(GL_COLOR_ARRAY);
+  glColorPointer(4, GL_FLOAT, sizeof(Vertex), reinterpret_cast<const void *>(offsetof(Vertex, r)));
+  // the ImGui renderer sets up its own arrays, leave the default VAO bound for it
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+VertexBuffer::~VertexBuffer()
+{
+  glDeleteBuffers(1, &vbo);
+  glDeleteVertexArrays(1, &vao);
+}
+
+auto VertexBuffer::upload(std::span<const Vertex> vertices) -> void
+{
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size_bytes(), vertices.data(), GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  size = static_cast<GLsizei>(vertices.size());
+}
+
+auto VertexBuffer::draw(GLenum mode) const -> void
+{
+  if (size == 0)
+    return;
+  glBindVertexArray(vao);
+  glDrawArrays(mode, 0, size);
+  glBindVertexArray(0);
+}
+
+auto VertexBuffer::empty() const -> bool
+{
+  return size == 0;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <imgui/imgui.h>
+#include <span>
+
+#if defined(IMGUI_IMPL_OPENGL_ES2)
+#include <SDL_opengles2.h>
+#else
+#include <SDL_opengl.h>
+#endif
+
+struct Vertex
+{
+  float x;
+  float y;
+  float s;
+  float t;
+  float r;
+  float g;
+  float b;
+  float a;
+};
+
+// Retained geometry: the vertices live in a VBO and the fixed function array state in a VAO, so
+// drawing a batch costs one call once it is uploaded.
+class VertexBuffer
+{
+public:
+  VertexBuffer();
+  ~VertexBuffer();
+  // disable copy
+  VertexBuffer(const VertexBuffer &) = delete;
+  VertexBuffer &operator=(const VertexBuffer &) = delete;
+
+  auto upload(std::span<const Vertex>) -> void;
+  auto draw(GLenum mode) const -> void;
+  auto empty() const -> bool;
+
+private:
+  GLuint vao;
+  GLuint vbo;
+  GLsizei size = 0;
+};
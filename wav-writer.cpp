@@ -0,0 +1,137 @@
+#include "wav-writer.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <log/log.hpp>
+
+namespace
+{
+  // header offsets of the sizes close() patches
+  const auto RiffSizePos = 4;
+  const auto FactSamplesPos = 44;
+} // namespace
+
+WavWriter::WavWriter(const std::string &fileName, int sampleRate, WavFormat format, bool isDither)
+  : f(fileName, std::ios::binary), format(format), isDither(isDither), buffer(BufferSize)
+{
+  if (!f)
+    return;
+
+  const auto isFloat = format == WavFormat::float32;
+  const auto bits = 8 * bytesPerSample();
+  // the sizes are filled in by close()
+  f << "RIFF----WAVEfmt ";
+  put(16, 4);                                            // no extension data
+  put(isFloat ? 3 : 1, 2);                               // 3 - IEEE float, 1 - integer PCM
+  put(1, 2);                                             // one channel (mono file)
+  put(static_cast<uint32_t>(sampleRate), 4);             // samples per second (Hz)
+  put(static_cast<uint32_t>(sampleRate * bits / 8), 4); // bytes per second
+  put(static_cast<uint32_t>(bits / 8), 2);               // bytes per sample frame
+  put(static_cast<uint32_t>(bits), 2);                   // bits per sample
+  // non-PCM data needs the number of samples in a fact chunk
+  if (isFloat)
+  {
+    flush();
+    f << "fact";
+    put(4, 4);
+    put(0, 4);
+  }
+  flush();
+  f << "data----";
+}
+
+WavWriter::~WavWriter()
+{
+  close();
+}
+
+auto WavWriter::isOpen() const -> bool
+{
+  return f.is_open() && f.good();
+}
+
+auto WavWriter::bytesPerSample() const -> int
+{
+  switch (format)
+  {
+  case WavFormat::pcm16: return 2;
+  case WavFormat::pcm24: return 3;
+  case WavFormat::float32: return 4;
+  }
+  return 2;
+}
+
+auto WavWriter::put(uint32_t value, int bytes) -> void
+{
+  for (; bytes > 0; --bytes, value >>= 8)
+    buffer[bufferUsed++] = static_cast<char>(value & 0xFF);
+}
+
+auto WavWriter::flush() -> void
+{
+  f.write(buffer.data(), static_cast<std::streamsize>(bufferUsed));
+  bufferUsed = 0;
+}
+
+auto WavWriter::dither() -> float
+{
+  // the difference of two uniform values in [0, 1) has a triangular distribution over (-1, 1) LSB
+  const auto uniform = [this]() {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return static_cast<float>(seed >> 8) * (1.f / (1 << 24));
+  };
+  return uniform() - uniform();
+}
+
+auto WavWriter::write(std::span<const float> pcm) -> void
+{
+  const auto bytes = bytesPerSample();
+  const auto scale = format == WavFormat::pcm24 ? 8388607.f : 32767.f;
+  for (auto a : pcm)
+  {
+    if (bufferUsed + 4 > buffer.size())
+      flush();
+    if (format == WavFormat::float32)
+    {
+      put(std::bit_cast<uint32_t>(a), 4);
+      continue;
+    }
+    const auto v = std::clamp(std::lrint(a * scale + (isDither ? dither() : 0.f)),
+                              -static_cast<long>(scale) - 1,
+                              static_cast<long>(scale));
+    put(static_cast<uint32_t>(v), bytes);
+  }
+  samplesNum += pcm.size();
+}
+
+auto WavWriter::close() -> void
+{
+  if (!f.is_open())
+    return;
+  flush();
+
+  const auto fileLength = static_cast<uint64_t>(f.tellp());
+  const auto dataSize = samplesNum * static_cast<uint64_t>(bytesPerSample());
+  if (fileLength - 8 > std::numeric_limits<uint32_t>::max())
+    LOG("the file is too long for WAV, the chunk sizes are clamped");
+  const auto clamp32 = [](uint64_t v) {
+    return static_cast<uint32_t>(std::min<uint64_t>(v, std::numeric_limits<uint32_t>::max()));
+  };
+
+  f.seekp(RiffSizePos);
+  put(clamp32(fileLength - 8), 4);
+  flush();
+  if (format == WavFormat::float32)
+  {
+    f.seekp(FactSamplesPos);
+    put(clamp32(samplesNum), 4);
+    flush();
+  }
+  f.seekp(static_cast<std::streamoff>(fileLength - dataSize - 4));
+  put(clamp32(dataSize), 4);
+  flush();
+  f.close();
+}
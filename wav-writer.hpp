@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string>
+#include <vector>
+
+enum class WavFormat
+{
+  pcm16,
+  pcm24,
+  float32
+};
+
+// Writes a mono WAV file block by block through a large buffer; the header goes out with placeholder
+// sizes that close() patches, so the file never has to be held in memory
+class WavWriter
+{
+public:
+  // isDither adds TPDF dither before rounding to 16 or 24 bits
+  WavWriter(const std::string &fileName, int sampleRate, WavFormat = WavFormat::pcm16, bool isDither = false);
+  ~WavWriter();
+  auto isOpen() const -> bool;
+  auto write(std::span<const float>) -> void;
+  auto close() -> void;
+
+private:
+  static constexpr auto BufferSize = size_t{1} << 20;
+
+  std::ofstream f;
+  WavFormat format;
+  bool isDither;
+  std::vector<char> buffer;
+  size_t bufferUsed = 0;
+  uint64_t samplesNum = 0;
+  // xorshift state for the dither
+  uint32_t seed = 2463534242U;
+
+  auto bytesPerSample() const -> int;
+  auto put(uint32_t value, int bytes) -> void;
+  auto flush() -> void;
+  auto dither() -> float;
+};
@@ -0,0 +1,76 @@
+#include "zero-crossings.hpp"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+ZeroCrossings::ZeroCrossings(std::span<const uint64_t> negative,
+                             std::span<const uint64_t> nonNegative,
+                             int size,
+                             int lookAround)
+  : bits(negative.size()), size(size)
+{
+  assert(negative.size() == nonNegative.size());
+  assert(lookAround > 0 && lookAround < 64);
+  const auto wordsNum = bits.size();
+  for (auto w = size_t{0}; w < wordsNum; ++w)
+  {
+    const auto neg = negative[w];
+    const auto prevNeg = w > 0 ? negative[w - 1] : uint64_t{0};
+    const auto nonNeg = nonNegative[w];
+    const auto nextNonNeg = w + 1 < wordsNum ? nonNegative[w + 1] : uint64_t{0};
+    // bit i of the shifted words holds the sign of sample i - j and i + 1 + j
+    auto ret = neg & (nonNeg >> 1 | nextNonNeg << 63);
+    for (auto j = 1; j < lookAround; ++j)
+      ret &= (neg << j | prevNeg >> (64 - j)) & (nonNeg >> (j + 1) | nextNonNeg << (63 - j));
+    bits[w] = ret;
+  }
+
+  // the margins of the scalar test: no crossing closer than lookAround to the start, or lookAround + 1 to
+  // the end
+  for (auto i = 0; i < std::min(lookAround, size); ++i)
+    bits[i / 64] &= ~(uint64_t{1} << (i % 64));
+  for (auto i = std::max(0, size - lookAround - 1); i < size; ++i)
+    bits[i / 64] &= ~(uint64_t{1} << (i % 64));
+}
+
+auto ZeroCrossings::first(int begin, int end) const -> int
+{
+  begin = std::max(begin, 0);
+  end = std::min(end, size);
+  if (begin >= end)
+    return -1;
+  auto w = begin / 64;
+  auto word = bits[w] & (~uint64_t{0} << (begin % 64));
+  for (;;)
+  {
+    if (word != 0)
+    {
+      const auto ret = w * 64 + std::countr_zero(word);
+      return ret < end ? ret : -1;
+    }
+    if (++w * 64 >= end)
+      return -1;
+    word = bits[w];
+  }
+}
+
+auto ZeroCrossings::last(int begin, int end) const -> int
+{
+  begin = std::max(begin, 0);
+  end = std::min(end, size);
+  if (begin >= end)
+    return -1;
+  auto w = (end - 1) / 64;
+  auto word = bits[w] & (~uint64_t{0} >> (63 - (end - 1) % 64));
+  for (;;)
+  {
+    if (word != 0)
+    {
+      const auto ret = w * 64 + 63 - std::countl_zero(word);
+      return ret >= begin ? ret : -1;
+    }
+    if (w-- * 64 <= begin)
+      return -1;
+    word = bits[w];
+  }
+}
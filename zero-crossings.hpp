@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Bitmap of the samples where the signal goes from negative to non-negative and stays there:
+// sample i is a crossing if wav[i - lookAround + 1..i] < 0 and wav[i + 1..i + lookAround] >= 0 (NaN passes
+// both), and lookAround <= i < size - lookAround - 1. Built from the signBits() masks with word-wide shifts.
+class ZeroCrossings
+{
+public:
+  ZeroCrossings(std::span<const uint64_t> negative, std::span<const uint64_t> nonNegative, int size, int lookAround);
+  // the first crossing in [begin, end), -1 if there is none
+  auto first(int begin, int end) const -> int;
+  // the last crossing in [begin, end), -1 if there is none
+  auto last(int begin, int end) const -> int;
+
+private:
+  std::vector<uint64_t> bits;
+  int size;
+};